@@ -0,0 +1,135 @@
+#pragma once
+#include "commons.h"
+#include "FamiTrackerFile.h"
+#include "InstrumentBase.h"
+#include "MidiEventParser.h"
+#include "FileSettingsJson.h"
+#include "Converter.h"
+
+// converts songs to tracks of one FamiTrackerFile
+// songs come from separate MIDI files or from the tracks of a format 2 MIDI file
+// instruments and DPCM samples are created once, then the tracks are converted by a pool of workers
+class AlbumConverter {
+private:
+	static constexpr size_t MAX_TITLE_LENGTH = 31; // apparently there is a char limit in the title
+
+	class Song {
+	public:
+		EventStore events;
+		std::wstring name;
+		std::shared_ptr<const FileSettingsJson> settings;
+		std::shared_ptr<const TempoMap> tempoMap; // shared by the songs of the file
+		double startSeconds; // position of the song in the tempo map
+
+		Song(EventStore&& events, std::wstring const& name, std::shared_ptr<const FileSettingsJson> settings, std::shared_ptr<const TempoMap> tempoMap, double startSeconds) :
+			events(std::move(events)), name(name), settings(settings), tempoMap(tempoMap), startSeconds(startSeconds) {}
+	};
+
+	std::optional<std::filesystem::path> cacheDirectory;
+	AssignCache& assignCache;
+	bool collectStats;
+	std::vector<Song> songs;
+	std::vector<std::pair<std::wstring, SearchStats>> songStats; // filled by convert when collectStats is set
+
+	static std::wstring limitTitle(std::wstring const& title) {
+		return title.length() > MAX_TITLE_LENGTH ? title.substr(0, MAX_TITLE_LENGTH) : title;
+	}
+
+public:
+	explicit AlbumConverter(AssignCache& assignCache, std::optional<std::filesystem::path> const& cacheDirectory = {}, bool collectStats = false)
+		: cacheDirectory(cacheDirectory), assignCache(assignCache), collectStats(collectStats) {}
+
+	// settings are loaded from the json file next to the MIDI file
+	void addMidiFile(std::filesystem::path const& midiFile) {
+		std::filesystem::path jsonFile = midiFile;
+		jsonFile.replace_extension("json");
+		auto settings = std::make_shared<const FileSettingsJson>(jsonFile);
+
+		MidiEventParser parser(midiFile, cacheDirectory);
+		EventStore const& events = parser.getEvents();
+		std::vector<EventStore> fileSongs = events.splitSongs();
+		auto tempoMap = std::make_shared<const TempoMap>(parser.getTempoMap());
+
+		// every song after the first starts at the end of the previous one
+		std::vector<double> startSeconds = { 0 };
+		for (int i = 0; i < events.size() && startSeconds.size() < fileSongs.size(); i++) {
+			if (events.getType(i) == MIDI_EVENT_END) {
+				startSeconds.push_back(events.getSeconds(i));
+			}
+		}
+
+		std::wstring name = midiFile.stem().wstring();
+		for (size_t i = 0; i < fileSongs.size(); i++) {
+			std::wstring songName = fileSongs.size() > 1 ? name + L" " + std::to_wstring(i + 1) : name;
+			songs.emplace_back(std::move(fileSongs[i]), limitTitle(songName), settings, tempoMap, startSeconds[i]);
+		}
+	}
+
+	size_t getSongCount() const {
+		return songs.size();
+	}
+
+	FamiTrackerFile convert(std::wstring const& title) {
+		FamiTrackerFile file;
+		file.title = limitTitle(title);
+		file.expansion = FamiTrackerFile::Expansion::VRC6;
+		file.comment = L"Created using MidiToFamiTrackerConverter by hakerg";
+
+		auto base = std::make_unique<InstrumentBase>();
+		base->fillBase(file);
+
+		std::vector<std::shared_ptr<Track>> tracks;
+		songStats.clear();
+		for (auto const& song : songs) {
+			tracks.push_back(file.addTrack(song.settings->rowsPerPattern, song.name));
+			if (collectStats) {
+				songStats.emplace_back(song.name, SearchStats());
+			}
+		}
+
+		std::vector<std::exception_ptr> errors(songs.size());
+		std::atomic<size_t> nextSong = 0;
+		auto worker = [this, &file, &base, &tracks, &errors, &nextSong]() {
+			for (size_t i = nextSong++; i < songs.size(); i = nextSong++) {
+				try {
+					SearchStats* stats = collectStats ? &songStats[i].second : nullptr;
+					std::make_unique<Converter>(*songs[i].settings, file, *base, assignCache, tracks[i])->convert(std::move(songs[i].events), *songs[i].tempoMap, songs[i].startSeconds, stats);
+				}
+				catch (...) {
+					errors[i] = std::current_exception();
+				}
+			}
+		};
+
+		{
+			// songs start their own tempo and assign workers, so the songs themselves use at most one thread per core
+			size_t workerCount = min(songs.size(), size_t(max(1, int(std::thread::hardware_concurrency()))));
+			std::vector<std::jthread> workers;
+			for (size_t i = 1; i < workerCount; i++) {
+				workers.emplace_back(worker);
+			}
+			worker();
+		}
+		songs.clear();
+
+		for (auto const& error : errors) {
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+
+		std::cout << "Created " << file.tracks.size() << " tracks, " << file.instruments.size() << " instruments and " << file.dpcmSamples.size() << " DPCM samples" << std::endl;
+		return file;
+	}
+
+	// search stats of the last convert, one entry per track
+	void exportStats(std::filesystem::path const& path) const {
+		nlohmann::json tracksJson = nlohmann::json::array();
+		for (auto const& [name, stats] : songStats) {
+			std::u8string utf8Name = std::filesystem::path(name).u8string();
+			tracksJson.push_back({ { "name", std::string(utf8Name.begin(), utf8Name.end()) }, { "sections", stats.toJson() } });
+		}
+		std::ofstream file(path);
+		file << nlohmann::json({ { "tracks", tracksJson } }).dump(1, '\t') << std::endl;
+	}
+};
@@ -0,0 +1,186 @@
+#pragma once
+#include "commons.h"
+#include "MidiState.h"
+#include "AssignData.h"
+#include "MidiChannelNotesData.h"
+#include "FileSettingsJson.h"
+#include "EventCache.h"
+
+// search results of sections shared by all conversions of the process, optionally kept in the cache directory between runs
+// the key holds everything the search reads - programs, file settings, the initial data and the note statistics,
+// interruption counts are reduced to which channels interrupt, so equal sections of any song hit the same entry
+class AssignCache {
+private:
+	static constexpr std::array<char, 8> MAGIC = { 'M', '2', 'F', 'T', 'A', 'S', 'G', 'N' };
+	static constexpr auto FILE_NAME = "assignments.cache";
+
+	class Header {
+	public:
+		std::array<char, 8> magic = MAGIC;
+		uint32_t version = 0;
+		uint32_t keySize = 0;
+		uint64_t entryCount = 0;
+	};
+
+	// the first bytes of every key, the key classes have no padding because keys are compared as bytes
+	class KeyPrefix {
+	public:
+		uint64_t settingsHash = 0;
+		std::array<int32_t, MidiState::CHANNEL_COUNT> programs{};
+		AssignData initData;
+	};
+
+	class ChannelSignature {
+	public:
+		double averageVolume = 0;
+		std::array<int32_t, 5> playedNotes{};
+		std::array<int32_t, int(NesChannel::CHANNEL_COUNT)> notesOutOfRange{};
+		uint16_t interruptedChannels = 0;
+		uint16_t maxChordSize = 0; // at most 4, assign configurations do not use more
+	};
+
+	static constexpr size_t KEY_SIZE = sizeof(KeyPrefix) + MidiState::CHANNEL_COUNT * sizeof(ChannelSignature);
+
+	std::optional<std::filesystem::path> directory;
+	std::unordered_map<std::string, AssignData> entries;
+	std::mutex mutex;
+	std::atomic<int> hits = 0;
+	std::atomic<int> misses = 0;
+
+	template<class T> static void append(std::string& key, T const& value) {
+		key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	void load() {
+		std::filesystem::path path = directory.value() / FILE_NAME;
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			return;
+		}
+
+		Header header;
+		file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+		if (!file || header.magic != MAGIC || header.version != VERSION || header.keySize != KEY_SIZE) {
+			return;
+		}
+
+		std::string key(KEY_SIZE, '\0');
+		AssignData data;
+		for (uint64_t i = 0; i < header.entryCount; i++) {
+			file.read(key.data(), std::streamsize(KEY_SIZE));
+			file.read(reinterpret_cast<char*>(&data), sizeof(AssignData));
+			if (!file) {
+				entries.clear();
+				return;
+			}
+			entries.emplace(key, data);
+		}
+		std::cout << "Loaded " << entries.size() << " channel assignments from cache" << std::endl;
+	}
+
+public:
+	// bump when the search or the scores change, it invalidates the stored assignments
+	static constexpr uint32_t VERSION = 1;
+
+	explicit AssignCache(std::optional<std::filesystem::path> const& directory = {}) : directory(directory) {
+		if (directory) {
+			load();
+		}
+	}
+
+	static uint64_t hashSettings(FileSettingsJson const& settings) {
+		std::string json = settings.json.dump();
+		return EventCache::hashBytes(reinterpret_cast<const uint8_t*>(json.data()), json.size());
+	}
+
+	// midiData must be calculated
+	static std::string getKey(uint64_t settingsHash, std::array<int, MidiState::CHANNEL_COUNT> const& programs, AssignData const& initData,
+		std::array<MidiChannelNotesData, MidiState::CHANNEL_COUNT> const& midiData) {
+
+		std::string key;
+		key.reserve(KEY_SIZE);
+
+		KeyPrefix prefix;
+		prefix.settingsHash = settingsHash;
+		std::ranges::copy(programs, prefix.programs.begin());
+		prefix.initData = initData;
+		append(key, prefix);
+
+		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			MidiChannelNotesData const& channelData = midiData[chan];
+			ChannelSignature signature; // channels without notes are never searched
+			if (channelData.notes > 0) {
+				signature.averageVolume = channelData.getAverageVolume();
+				std::ranges::copy(channelData.playedNotes, signature.playedNotes.begin());
+				std::ranges::copy(channelData.notesOutOfRange, signature.notesOutOfRange.begin());
+				for (int chan2 = 0; chan2 < MidiState::CHANNEL_COUNT; chan2++) {
+					if (midiData[chan2].notes > 0 && channelData.interruptingNotes[chan2] > 0) {
+						signature.interruptedChannels |= uint16_t(1 << chan2);
+					}
+				}
+				signature.maxChordSize = uint16_t(min(4, int(channelData.noteCountAtNotesOn.size())));
+			}
+			append(key, signature);
+		}
+		return key;
+	}
+
+	std::optional<AssignData> find(std::string const& key) {
+		std::scoped_lock lock(mutex);
+		auto it = entries.find(key);
+		if (it == entries.end()) {
+			misses++;
+			return std::nullopt;
+		}
+		hits++;
+		return it->second;
+	}
+
+	void insert(std::string const& key, AssignData const& data) {
+		std::scoped_lock lock(mutex);
+		entries.emplace(key, data);
+	}
+
+	int getHits() const {
+		return hits;
+	}
+
+	int getMisses() const {
+		return misses;
+	}
+
+	// written to a temporary file first, so a concurrent run never reads a partial cache
+	void store() {
+		if (!directory) {
+			return;
+		}
+
+		std::scoped_lock lock(mutex);
+		std::error_code error;
+		std::filesystem::create_directories(directory.value(), error);
+
+		Header header;
+		header.version = VERSION;
+		header.keySize = uint32_t(KEY_SIZE);
+		header.entryCount = entries.size();
+
+		std::filesystem::path path = directory.value() / FILE_NAME;
+		std::filesystem::path temporaryPath = EventCache::getTemporaryPath(path);
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+			for (auto const& [key, data] : entries) {
+				file.write(key.data(), std::streamsize(key.size()));
+				file.write(reinterpret_cast<const char*>(&data), sizeof(AssignData));
+			}
+			if (!file) {
+				std::cout << "Cannot write assignment cache " << temporaryPath << std::endl;
+				return;
+			}
+		}
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error) {
+			std::filesystem::remove(temporaryPath, error);
+		}
+	}
+};
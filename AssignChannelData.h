@@ -21,6 +21,8 @@ public:
 
 	AssignChannelData(Preset::Duty duty, std::initializer_list<NesChannel> const& nesChannels) : duty(duty), nesChannels(initBitset(nesChannels)) {}
 
+	AssignChannelData(Preset::Duty duty, std::bitset<int(NesChannel::CHANNEL_COUNT)> const& nesChannels) : duty(duty), nesChannels(nesChannels) {}
+
 	std::vector<NoteTriggerData> getTriggers(Preset const& preset, bool lowerKeysFirst) const {
 		std::vector<NoteTriggerData> results;
 		forEachAssignedChannel([&results, &preset, lowerKeysFirst, this](NesChannel nesChannel) {
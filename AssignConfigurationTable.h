@@ -0,0 +1,120 @@
+#pragma once
+#include "commons.h"
+#include "Preset.h"
+#include "AssignChannelData.h"
+
+// assign configurations of every preset kind, stored in one flat array
+// the table depends only on useVrc6, so both variants are built once per process and shared by all assigners
+class AssignConfigurationTable {
+private:
+	static constexpr int ID_COUNT = 1024; // id is 10 bits
+
+	class Range {
+	public:
+		uint16_t offset = 0;
+		uint16_t count = 0;
+	};
+
+	bool useVrc6;
+	std::vector<AssignChannelData> configurations;
+	std::array<Range, ID_COUNT> ranges{};
+
+	static int getId(Preset::Duty duty, Preset::Channel channel, bool isSimpleLoop, int maxChannelCount) {
+		return int(duty) // 3b
+			+ (int(channel) << 3) // 3b
+			+ (int(isSimpleLoop) << 6) // 1b
+			+ (min(4, maxChannelCount) << 7); // 3b
+	}
+
+	std::vector<AssignChannelData> getMelodicConfigurations(Preset::Duty duty, bool isSimpleLoop, int maxChannelCount) const {
+		using enum Preset::Duty;
+		using enum NesChannel;
+		std::vector<AssignChannelData> results;
+
+		if (maxChannelCount <= 0) {
+			return results;
+		}
+
+		results.push_back(AssignChannelData(duty, { PULSE2 }));
+		results.push_back(AssignChannelData(duty, { PULSE1 }));
+		if (maxChannelCount >= 2) {
+			results.push_back(AssignChannelData(duty, { PULSE1, PULSE2 }));
+		}
+
+		if (useVrc6) {
+			results.push_back(AssignChannelData(duty, { PULSE4 }));
+			results.push_back(AssignChannelData(duty, { PULSE3 }));
+			if (maxChannelCount >= 2) {
+				results.push_back(AssignChannelData(duty, { PULSE3, PULSE4 }));
+				results.push_back(AssignChannelData(duty, { PULSE2, PULSE4 }));
+				results.push_back(AssignChannelData(duty, { PULSE2, PULSE3 }));
+				results.push_back(AssignChannelData(duty, { PULSE1, PULSE4 }));
+				results.push_back(AssignChannelData(duty, { PULSE1, PULSE3 }));
+			}
+			if (maxChannelCount >= 3) {
+				results.push_back(AssignChannelData(duty, { PULSE2, PULSE3, PULSE4 }));
+				results.push_back(AssignChannelData(duty, { PULSE1, PULSE3, PULSE4 }));
+				results.push_back(AssignChannelData(duty, { PULSE1, PULSE2, PULSE4 }));
+				results.push_back(AssignChannelData(duty, { PULSE1, PULSE2, PULSE3 }));
+			}
+			if (maxChannelCount >= 4) {
+				results.push_back(AssignChannelData(duty, { PULSE1, PULSE2, PULSE3, PULSE4 }));
+			}
+
+			results.push_back(AssignChannelData(UNSPECIFIED, { SAWTOOTH }));
+		}
+
+		// cannot use triangle to play i.e. piano, because triangle does not decay
+		if (isSimpleLoop) {
+			results.push_back(AssignChannelData(UNSPECIFIED, { TRIANGLE }));
+		}
+
+		return results;
+	}
+
+	std::vector<AssignChannelData> getConfigurations(Preset::Duty duty, Preset::Channel channel, bool isSimpleLoop, int maxChannelCount) const {
+		switch (channel) {
+		case Preset::Channel::PULSE:
+		case Preset::Channel::TRIANGLE:
+		case Preset::Channel::SAWTOOTH:
+			return getMelodicConfigurations(duty, isSimpleLoop, maxChannelCount);
+		case Preset::Channel::NOISE:
+			return { AssignChannelData(duty, { NesChannel::NOISE }) };
+		case Preset::Channel::DPCM:
+			return { AssignChannelData(duty, { NesChannel::DPCM }) };
+		default:
+			return {};
+		}
+	}
+
+	explicit AssignConfigurationTable(bool useVrc6) : useVrc6(useVrc6) {
+		for (int dutyI = 0; dutyI < int(Preset::Duty::DUTY_COUNT); dutyI++) {
+			for (int channelI = 0; channelI < int(Preset::Channel::CHANNEL_COUNT); channelI++) {
+				for (int isSimpleLoopI = 0; isSimpleLoopI < 2; isSimpleLoopI++) {
+					for (int maxChannelCount = 0; maxChannelCount <= 4; maxChannelCount++) {
+						auto duty = Preset::Duty(dutyI);
+						auto channel = Preset::Channel(channelI);
+						auto isSimpleLoop = bool(isSimpleLoopI);
+
+						std::vector<AssignChannelData> idConfigurations = getConfigurations(duty, channel, isSimpleLoop, maxChannelCount);
+						ranges[getId(duty, channel, isSimpleLoop, maxChannelCount)] = { uint16_t(configurations.size()), uint16_t(idConfigurations.size()) };
+						configurations.insert(configurations.end(), idConfigurations.begin(), idConfigurations.end());
+					}
+				}
+			}
+		}
+	}
+
+public:
+	// built on the first call, initialization of the statics is thread safe
+	static AssignConfigurationTable const& get(bool useVrc6) {
+		static const AssignConfigurationTable withVrc6(true);
+		static const AssignConfigurationTable withoutVrc6(false);
+		return useVrc6 ? withVrc6 : withoutVrc6;
+	}
+
+	std::span<const AssignChannelData> getConfigurations(Preset const& preset, int maxChannelCount) const {
+		Range range = ranges[getId(preset.duty, preset.channel, preset.isSimpleLoop(), maxChannelCount)];
+		return std::span<const AssignChannelData>(configurations).subspan(range.offset, range.count);
+	}
+};
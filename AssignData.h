@@ -4,51 +4,75 @@
 #include "AssignChannelData.h"
 #include "MidiState.h"
 
+// NES channel masks and duties of all MIDI channels packed into three words, so copies, comparison and hashing are cheap
 class AssignData {
 private:
 	friend struct std::hash<AssignData>;
+	friend class AssignDataSet;
 
-	std::array<AssignChannelData, MidiState::CHANNEL_COUNT> nesData;
+	static constexpr int MASK_BITS = int(NesChannel::CHANNEL_COUNT);
+	static constexpr int MASKS_PER_WORD = 64 / MASK_BITS;
+	static constexpr int DUTY_BITS = 3;
+	static_assert(MASK_BITS == 8 && int(Preset::Duty::DUTY_COUNT) <= (1 << DUTY_BITS) && MidiState::CHANNEL_COUNT * DUTY_BITS < 64);
+
+	std::array<uint64_t, MidiState::CHANNEL_COUNT / MASKS_PER_WORD> masks{};
+	uint64_t duties = 0; // the highest bit is never set, AssignDataSet uses it for empty slots
+
+	void setMask(int midiChannel, uint64_t mask) {
+		int shift = midiChannel % MASKS_PER_WORD * MASK_BITS;
+		uint64_t& word = masks[midiChannel / MASKS_PER_WORD];
+		word = (word & ~(uint64_t(0xFF) << shift)) | (mask << shift);
+	}
 
 public:
-	explicit AssignData(std::array<AssignChannelData, MidiState::CHANNEL_COUNT> const& nesData) : nesData(nesData) {}
+	AssignData() = default;
+
+	explicit AssignData(std::array<AssignChannelData, MidiState::CHANNEL_COUNT> const& nesData) {
+		for (size_t i = 0; i < nesData.size(); i++) {
+			assign(int(i), nesData[i]);
+		}
+	}
+
+	uint8_t getMask(int midiChannel) const {
+		return uint8_t(masks[midiChannel / MASKS_PER_WORD] >> (midiChannel % MASKS_PER_WORD * MASK_BITS));
+	}
+
+	Preset::Duty getDuty(int midiChannel) const {
+		return Preset::Duty((duties >> (midiChannel * DUTY_BITS)) & ((1 << DUTY_BITS) - 1));
+	}
 
-	const AssignChannelData& getNesData(int midiChannel) const {
-		return nesData[midiChannel];
+	AssignChannelData getNesData(int midiChannel) const {
+		return AssignChannelData(getDuty(midiChannel), std::bitset<int(NesChannel::CHANNEL_COUNT)>(getMask(midiChannel)));
 	}
 
 	bool isAssigned(int midiChannel, NesChannel nesChannel) const {
-		return getNesData(midiChannel).isAssigned(nesChannel);
+		return (getMask(midiChannel) >> int(nesChannel)) & 1;
 	}
 
 	void assign(int midiChannel, AssignChannelData const& data) {
-		nesData[midiChannel] = data;
+		setMask(midiChannel, data.nesChannels.to_ulong());
+		setDuty(midiChannel, data.duty);
 	}
 
 	void reset(int midiChannel) {
-		nesData[midiChannel] = AssignChannelData();
+		assign(midiChannel, AssignChannelData());
 	}
 
 	void unassign(int midiChannel, NesChannel nesChannel) {
-		nesData[midiChannel].nesChannels.reset(int(nesChannel));
+		masks[midiChannel / MASKS_PER_WORD] &= ~(uint64_t(1) << (midiChannel % MASKS_PER_WORD * MASK_BITS + int(nesChannel)));
 	}
 
 	void setDuty(int midiChannel, Preset::Duty duty) {
-		nesData[midiChannel].duty = duty;
+		int shift = midiChannel * DUTY_BITS;
+		duties = (duties & ~(uint64_t((1 << DUTY_BITS) - 1) << shift)) | (uint64_t(duty) << shift);
 	}
 
-	bool operator == (const AssignData& other) const {
-		for (int i = 0; i < nesData.size(); i++) {
-			if (!(nesData[i] == other.nesData[i])) {
-				return false;
-			}
-		}
-		return true;
-	}
+	bool operator == (const AssignData& other) const = default;
 
 	int countPulseDuty(Preset::Duty duty) const {
 		int count = 0;
-		for (auto& channelData : nesData) {
+		for (int i = 0; i < MidiState::CHANNEL_COUNT; i++) {
+			AssignChannelData channelData = getNesData(i);
 			if (channelData.duty == duty && channelData.getChannel() == Preset::Channel::PULSE) {
 				count += int(channelData.nesChannels.count());
 			}
@@ -60,12 +84,11 @@ public:
 namespace std {
 	template<> struct hash<AssignData> {
 		std::size_t operator () (const AssignData& data) const {
-			std::size_t h = 0;
-			std::hash<int> hasher;
-			for (const auto& nesData : data.nesData) {
-				h ^= hasher(nesData.getUniqueId()) + 0x9e3779b9 + (h << 6) + (h >> 2);
-			}
-			return h;
+			constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15;
+			uint64_t h = (data.masks[0] * MULTIPLIER) ^ data.masks[1];
+			h = (h * MULTIPLIER) ^ data.duties;
+			h *= MULTIPLIER;
+			return std::size_t(h ^ (h >> 32));
 		}
 	};
-}
\ No newline at end of file
+}
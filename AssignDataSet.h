@@ -0,0 +1,84 @@
+#pragma once
+#include "commons.h"
+#include "AssignData.h"
+
+// set of AssignData visited by the search, open addressing with linear probing in one flat array
+// unlike std::unordered_set it does not allocate per insert, and clear() keeps the capacity for the next section
+class AssignDataSet {
+private:
+	static constexpr uint64_t EMPTY_DUTIES = UINT64_MAX; // no AssignData has all duty bits set
+
+	std::vector<AssignData> slots;
+	size_t count = 0;
+
+	static AssignData getEmptySlot() {
+		AssignData slot;
+		slot.duties = EMPTY_DUTIES;
+		return slot;
+	}
+
+	static bool isEmpty(AssignData const& slot) {
+		return slot.duties == EMPTY_DUTIES;
+	}
+
+	size_t findSlot(AssignData const& data) const {
+		size_t mask = slots.size() - 1;
+		size_t i = std::hash<AssignData>()(data) & mask;
+		while (!isEmpty(slots[i]) && !(slots[i] == data)) {
+			i = (i + 1) & mask;
+		}
+		return i;
+	}
+
+	void rehash(size_t capacity) {
+		std::vector<AssignData> oldSlots = std::move(slots);
+		slots.assign(capacity, getEmptySlot());
+		for (auto const& slot : oldSlots) {
+			if (!isEmpty(slot)) {
+				slots[findSlot(slot)] = slot;
+			}
+		}
+	}
+
+public:
+	// the load factor is kept at most 1/2
+	explicit AssignDataSet(size_t expectedCount = 0) {
+		rehash(std::bit_ceil(max(size_t(16), expectedCount * 2)));
+	}
+
+	// returns false if the data was already in the set
+	bool insert(AssignData const& data) {
+		if ((count + 1) * 2 > slots.size()) {
+			rehash(slots.size() * 2);
+		}
+
+		size_t i = findSlot(data);
+		if (!isEmpty(slots[i])) {
+			return false;
+		}
+		slots[i] = data;
+		count++;
+		return true;
+	}
+
+	bool contains(AssignData const& data) const {
+		return !isEmpty(slots[findSlot(data)]);
+	}
+
+	void insertAll(AssignDataSet const& other) {
+		for (auto const& slot : other.slots) {
+			if (!isEmpty(slot)) {
+				insert(slot);
+			}
+		}
+	}
+
+	void clear() {
+		std::fill(slots.begin(), slots.end(), getEmptySlot());
+		count = 0;
+	}
+
+	size_t size() const {
+		return count;
+	}
+};
@@ -0,0 +1,183 @@
+#pragma once
+#include "commons.h"
+#include "MidiState.h"
+#include "AssignData.h"
+#include "InstrumentBase.h"
+#include "Preset.h"
+#include "SoundWaveProfile.h"
+#include "MidiChannelNotesData.h"
+#include "FileSettingsJson.h"
+
+// scores AssignData of one section from tables filled once per section
+// a search step changes one MIDI channel, so only that channel and the channels it can interrupt are scored again
+class AssignScorer {
+public:
+	static constexpr double MIN_CHANNELS_MULTIPLIER = 0.001; // for every channel with less than minNesChannels NES channels
+
+	class ScoredData {
+	public:
+		AssignData data;
+		std::array<double, MidiState::CHANNEL_COUNT> channelScores{};
+		double score = 0;
+	};
+
+private:
+	static constexpr int MASK_COUNT = 1 << int(NesChannel::CHANNEL_COUNT);
+
+	using ChannelSimilarities = std::array<std::array<double, int(Preset::Duty::DUTY_COUNT)>, int(Preset::Channel::CHANNEL_COUNT)>;
+
+	const FileSettingsJson& settings;
+
+	// channels without notes or without a preset are never scored
+	std::bitset<MidiState::CHANNEL_COUNT> scoredChannels;
+	std::bitset<MidiState::CHANNEL_COUNT> melodicChannels;
+
+	// bit chan2 of interruptingChannels[chan] - melodic chan gets no score when it shares a NES channel with chan2
+	std::array<uint16_t, MidiState::CHANNEL_COUNT> interruptingChannels{};
+	// transposed, channels whose score depends on the assignment of chan
+	std::array<uint16_t, MidiState::CHANNEL_COUNT> interruptedChannels{};
+
+	// the channel score without interruptions is notesScores[chan][mask] * audioSimilarities[chan][channel of mask][duty]
+	// the table is indexed by the NES channel mask, because unassigning makes masks that are not in the assign configurations
+	std::array<std::array<double, MASK_COUNT>, MidiState::CHANNEL_COUNT> notesScores{};
+	std::array<ChannelSimilarities, MidiState::CHANNEL_COUNT> audioSimilarities{};
+	std::array<Preset::Channel, MASK_COUNT> maskChannels{};
+
+	static double countNotesOutOfRange(AssignChannelData const& nesData, MidiChannelNotesData const& channelData) {
+		double count = 0;
+		for (size_t i = 0; i < channelData.notesOutOfRange.size(); i++) {
+			if (nesData.isAssigned(NesChannel(i))) {
+				count += channelData.notesOutOfRange[i];
+			}
+		}
+		return count;
+	}
+
+	void fillTables(int chan, Preset const& preset, MidiChannelNotesData const& channelData) {
+		for (int mask = 1; mask < MASK_COUNT; mask++) {
+			AssignChannelData nesData(Preset::Duty::UNSPECIFIED, std::bitset<int(NesChannel::CHANNEL_COUNT)>(mask));
+			size_t assignedChannelCount = nesData.nesChannels.count();
+			if (assignedChannelCount >= channelData.playedNotes.size()) {
+				continue; // assign configurations have at most 4 NES channels
+			}
+			double notesScore = channelData.playedNotes[assignedChannelCount] - countNotesOutOfRange(nesData, channelData);
+			notesScores[chan][mask] = notesScore * channelData.getAverageVolume();
+		}
+
+		for (int channel = 0; channel < int(Preset::Channel::CHANNEL_COUNT); channel++) {
+			for (int duty = 0; duty < int(Preset::Duty::DUTY_COUNT); duty++) {
+				// how much a NES channel with the duty is similar to original instrument from the base
+				audioSimilarities[chan][channel][duty] = SoundWaveProfile(preset.channel, preset.duty).getSimilarity(SoundWaveProfile(Preset::Channel(channel), Preset::Duty(duty)));
+			}
+		}
+	}
+
+	bool isInterruptingNotes(AssignData const& assignData, int chan) const {
+		uint8_t nesChannels = assignData.getMask(chan);
+		for (uint16_t chans2 = interruptingChannels[chan]; chans2 != 0; chans2 &= chans2 - 1) {
+			if ((nesChannels & assignData.getMask(std::countr_zero(chans2))) != 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	double calculateChannelScore(AssignData const& assignData, int chan) const {
+		uint8_t mask = assignData.getMask(chan);
+		if (mask == 0 || !scoredChannels.test(chan)) {
+			return 0;
+		}
+
+		if (melodicChannels.test(chan) && isInterruptingNotes(assignData, chan)) {
+			return 0;
+		}
+
+		return notesScores[chan][mask] * audioSimilarities[chan][int(maskChannels[mask])][int(assignData.getDuty(chan))];
+	}
+
+	// summed in channel order, so the score does not depend on which channels were scored again
+	void updateScore(ScoredData& scoredData) const {
+		double score = 0;
+		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			score += scoredData.channelScores[chan];
+		}
+		scoredData.score = score * getMinChannelsMultiplier(scoredData.data);
+	}
+
+public:
+	AssignScorer(InstrumentBase const& instrumentBase, FileSettingsJson const& settings, std::array<MidiChannelNotesData, MidiState::CHANNEL_COUNT> const& midiData,
+		std::array<int, MidiState::CHANNEL_COUNT> const& programs) : settings(settings) {
+
+		for (int mask = 1; mask < MASK_COUNT; mask++) {
+			maskChannels[mask] = AssignChannelData(Preset::Duty::UNSPECIFIED, std::bitset<int(NesChannel::CHANNEL_COUNT)>(mask)).getChannel();
+		}
+
+		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			Preset const* preset = instrumentBase.getGmPreset(programs[chan]);
+			if (!preset || midiData[chan].notes <= 0) {
+				continue;
+			}
+			scoredChannels.set(chan);
+			fillTables(chan, *preset, midiData[chan]);
+
+			if (preset->order != Preset::Order::MELODIC) {
+				continue;
+			}
+			melodicChannels.set(chan);
+
+			for (int chan2 = 0; chan2 < MidiState::CHANNEL_COUNT; chan2++) {
+				if (midiData[chan2].notes > 0 && midiData[chan].interruptingNotes[chan2] > 0) {
+					interruptingChannels[chan] |= uint16_t(1 << chan2);
+					interruptedChannels[chan2] |= uint16_t(1 << chan);
+				}
+			}
+		}
+	}
+
+	double getMinChannelsMultiplier(AssignData const& assignData) const {
+		double multiplier = 1;
+		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			// not met the requirements
+			if (std::popcount(assignData.getMask(chan)) < settings.minNesChannels[chan]) {
+				multiplier *= MIN_CHANNELS_MULTIPLIER;
+			}
+		}
+		return multiplier;
+	}
+
+	ScoredData score(AssignData const& assignData) const {
+		ScoredData result{ assignData };
+		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			result.channelScores[chan] = calculateChannelScore(assignData, chan);
+		}
+		updateScore(result);
+		return result;
+	}
+
+	// the score of chan when no other channel interrupts it, an upper bound of its score in any AssignData
+	double getUninterruptedScore(int chan, AssignChannelData const& nesData) const {
+		auto mask = uint8_t(nesData.nesChannels.to_ulong());
+		if (mask == 0 || !scoredChannels.test(chan)) {
+			return 0;
+		}
+		return notesScores[chan][mask] * audioSimilarities[chan][int(maskChannels[mask])][int(nesData.duty)];
+	}
+
+	// assignData differs from the scored data only by the assignment of chan
+	ScoredData rescore(ScoredData const& scoredData, AssignData const& assignData, int chan) const {
+		ScoredData result{ assignData, scoredData.channelScores };
+		result.channelScores[chan] = calculateChannelScore(assignData, chan);
+
+		// only channels sharing a NES channel with the old or the new assignment of chan can change their interruption
+		uint8_t changedNesChannels = scoredData.data.getMask(chan) | assignData.getMask(chan);
+		for (uint16_t chans = interruptedChannels[chan]; chans != 0; chans &= chans - 1) {
+			int interruptedChan = std::countr_zero(chans);
+			if ((assignData.getMask(interruptedChan) & changedNesChannels) != 0) {
+				result.channelScores[interruptedChan] = calculateChannelScore(assignData, interruptedChan);
+			}
+		}
+
+		updateScore(result);
+		return result;
+	}
+};
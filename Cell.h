@@ -20,7 +20,7 @@ public:
 	enum class Type { EMPTY, NOTE, STOP, RELEASE };
 
 	Type type;
-	std::optional<Note> note;
+	std::optional<::Note> note;
 	std::shared_ptr<Instrument> instrument;
 	int volume = -1;
 	std::vector<Effect> effects{};
@@ -32,7 +32,7 @@ public:
 		return channel == PULSE3 || channel == PULSE4 || channel == SAWTOOTH;
 	}
 
-	void Note(Note note_, std::shared_ptr<Instrument> instrument_, int volume_ = -1) {
+	void Note(::Note note_, std::shared_ptr<Instrument> instrument_, int volume_ = -1) {
 		type = Type::NOTE;
 		note = note_;
 		instrument = instrument_;
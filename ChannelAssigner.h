@@ -2,12 +2,17 @@
 #include "commons.h"
 #include "MidiState.h"
 #include "AssignData.h"
+#include "AssignDataSet.h"
 #include "InstrumentBase.h"
 #include "Preset.h"
-#include "SoundWaveProfile.h"
 #include "MidiChannelNotesData.h"
 #include "NesHeightVolumeController.h"
 #include "FileSettingsJson.h"
+#include "AssignScorer.h"
+#include "AssignCache.h"
+#include "DutyBound.h"
+#include "SearchStats.h"
+#include "AssignConfigurationTable.h"
 
 class IndexedAssignData {
 public:
@@ -16,254 +21,499 @@ public:
 	std::array<int, MidiState::CHANNEL_COUNT> programs;
 
 	IndexedAssignData(AssignData const& data, int eventIndex, std::array<int, MidiState::CHANNEL_COUNT> const& programs) : data(data), eventIndex(eventIndex), programs(programs) {}
+
+	// the data without channels whose program changed, the next section starts from it
+	AssignData getCleanData(std::array<int, MidiState::CHANNEL_COUNT> const& newPrograms) const {
+		AssignData ret = data;
+		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			if (newPrograms[chan] != programs[chan]) {
+				ret.reset(chan);
+			}
+		}
+		return ret;
+	}
 };
 
-class ChannelAssigner {
+// Stats is NoSearchStats or SearchStats
+template<class Stats = NoSearchStats> class ChannelAssigner {
 private:
 
-	class ScoredAssignData {
+	static constexpr int TIME_CHECK_INTERVAL = 1024; // scored states between reading the clock
+	static constexpr size_t SPLIT_WAVE_MOVES = 4; // branches of the split search that do not see the states of each other, independent of the thread count
+
+	// a state one move away from the start of a split depth first search round
+	class Move {
 	public:
 		AssignData data;
-		double score;
-
-		ScoredAssignData(AssignData const& data, double score) : data(data), score(score) {}
+		int chan;
+		bool isAssign;
 	};
 
-	std::array<std::vector<AssignChannelData>, 1024> assignConfigurationLookup{}; // index is 10 bits
-
 	const InstrumentBase& instrumentBase;
 	const FileSettingsJson& settings;
+	AssignConfigurationTable const& assignConfigurations;
+	AssignCache& assignCache;
+	uint64_t settingsHash;
+	int searchThreadCount;
 	std::array<int, MidiState::CHANNEL_COUNT> programs{};
 	int eventIndex = 0;
+	int pass = 0;
 	std::array<MidiChannelNotesData, MidiState::CHANNEL_COUNT> midiData;
-	IndexedAssignData lastData{ IndexedAssignData(AssignData({}), 0, {}) };
-	ScoredAssignData bestData{ AssignData({}), 0 };
+	IndexedAssignData lastData{ IndexedAssignData(AssignData(), 0, {}) };
+	AssignScorer::ScoredData bestData; // score includes the duty diversity while diversing duties
+	AssignDataSet visited; // starts small and grows to the largest section, kept between sections to reuse its memory
+	std::optional<AssignScorer> scorer; // scores the current section
+	std::optional<DutyBound> dutyBound; // while diversing duties
+	std::array<std::vector<AssignChannelData>, MidiState::CHANNEL_COUNT> channelConfigurations; // allowed configurations of the current section
+	// exact search of the current section, channels are valued in exactOrder
+	std::array<std::vector<AssignChannelData>, MidiState::CHANNEL_COUNT> channelDomains;
+	std::vector<int> exactOrder;
+	std::vector<double> remainingScoreBounds; // [i] - sum of the best uninterrupted scores of exactOrder[i..]
+	std::vector<double> remainingMultiplierBounds; // [i] - product of the best min channel multipliers of exactOrder[i..]
+	int searchedNodes = 0;
+	int nodeBudget = 0; // searchNodeBudget, or the share of one branch of the split search
+	bool isBudgetSpent = false;
+	std::chrono::steady_clock::time_point deadline;
+	Stats stats;
+	std::vector<std::unique_ptr<ChannelAssigner>> branchAssigners; // split depth first search, one per worker, kept between sections
+	std::array<AssignDataSet, SPLIT_WAVE_MOVES> waveVisited; // states of the branches of the current wave
+	AssignDataSet const* sharedVisited = nullptr; // branch assigner - states of the owner and of the previous waves
+
+	void replaceIfBetter(AssignScorer::ScoredData const& scoredData, bool includeDutyDiversity) {
+		double newScore = scoredData.score;
+		if (includeDutyDiversity) {
+			newScore *= getDutyDiversityScore(scoredData.data);
+		}
 
-	static double getAudioSimilarity(Preset const& preset, AssignChannelData const& channelData) {
-		return SoundWaveProfile(preset.channel, preset.duty).getSimilarity(SoundWaveProfile(channelData.getChannel(), channelData.duty));
+		if (newScore > bestData.score) {
+			bestData = scoredData;
+			bestData.score = newScore;
+			if (!includeDutyDiversity) {
+				stats.addBestScore(newScore);
+			}
+		}
 	}
 
-	double calculateScore(AssignData const& assignData) const {
-		double score = 0;
-		double scoreMultiplier = 1;
+	AssignScorer::ScoredData rescore(AssignScorer::ScoredData const& scoredData, AssignData const& assignData, int chan) {
+		stats.addScoring();
+		return scorer->rescore(scoredData, assignData, chan);
+	}
 
-		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
-			const AssignChannelData& nesData = assignData.getNesData(chan);
+	// counts a scored state, the search stops once the node or the time budget of the section is spent
+	// a state is new if neither the previous waves of the split search nor checked have it
+	bool visit(AssignDataSet& checked, AssignData const& data) {
+		if (sharedVisited && sharedVisited->contains(data)) {
+			return false;
+		}
+		return checked.insert(data);
+	}
 
-			// not met the requirements
-			if (nesData.nesChannels.count() < settings.minNesChannels[chan]) {
-				scoreMultiplier *= 0.001;
-			}
+	void spendNode() {
+		searchedNodes++;
+		if (nodeBudget > 0 && searchedNodes >= nodeBudget) {
+			isBudgetSpent = true;
+		}
+		if (settings.searchTimeBudgetMs > 0 && searchedNodes % TIME_CHECK_INTERVAL == 0 && std::chrono::steady_clock::now() >= deadline) {
+			isBudgetSpent = true;
+		}
+	}
 
-			if (nesData.nesChannels.none()) {
-				continue;
-			}
+	void tryUnassignSomeChannels(AssignScorer::ScoredData const& workingData, int depth, AssignDataSet& checked) {
 
-			std::optional<Preset> preset = instrumentBase.getGmPreset(programs[chan]);
-			if (!preset) {
-				continue;
-			}
+		if (depth == 0 || isBudgetSpent) {
+			return;
+		}
+		depth--;
+		stats.addExpandedNode();
 
-			const MidiChannelNotesData& channelData = midiData[chan];
-			if (channelData.notes <= 0) {
+		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			if (midiData[chan].notes <= 0 || !settings.channelsEnabled[chan]) {
 				continue;
 			}
 
-			if (preset->order == Preset::Order::MELODIC && isInterruptingNotes(assignData, chan)) {
-				continue;
-			}
+			workingData.data.getNesData(chan).forEachAssignedChannel([&workingData, depth, &checked, chan, this](NesChannel nesChannel) {
+				if (isBudgetSpent) {
+					return;
+				}
 
-			auto assignedChannelCount = int(nesData.nesChannels.count());
-			double notesScore = channelData.playedNotes[assignedChannelCount] - countNotesOutOfRange(nesData, channelData);
+				AssignData newData = workingData.data;
+				newData.unassign(chan, nesChannel);
+
+				if (!visit(checked, newData)) {
+					stats.addDuplicate();
+					return;
+				}
 
-			// getAudioSimilarity() checks how much provided nesData is similar to original instrument from the base
-			double audioSimilarity = getAudioSimilarity(preset.value(), nesData);
+				AssignScorer::ScoredData scoredData = rescore(workingData, newData, chan);
+				replaceIfBetter(scoredData, false);
+				spendNode();
 
-			double channelScore = notesScore * channelData.getAverageVolume() * audioSimilarity;
-			score += channelScore;
+				tryAssignSomeChannels(scoredData, depth, checked);
+			});
 		}
 
-		return score * scoreMultiplier;
+		tryAssignSomeChannels(workingData, depth, checked);
 	}
 
-	double countNotesOutOfRange(AssignChannelData const& nesData, MidiChannelNotesData const& channelData) const {
-		double count = 0;
-		for (int i = 0; i < channelData.notesOutOfRange.size(); i++) {
-			if (nesData.isAssigned(NesChannel(i))) {
-				count += channelData.notesOutOfRange[i];
-			}
-		}
-		return count;
-	}
+	void tryAssignSomeChannels(AssignScorer::ScoredData const& workingData, int depth, AssignDataSet& checked) {
 
-	bool isInterruptingNotes(AssignData const& assignData, int chan) const {
-		auto& nesChannels = assignData.getNesData(chan).nesChannels;
+		if (depth == 0 || isBudgetSpent) {
+			return;
+		}
+		depth--;
+		stats.addExpandedNode();
 
-		for (int chan2 = 0; chan2 < MidiState::CHANNEL_COUNT; chan2++) {
-			if (midiData[chan2].notes <= 0) {
+		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			if (midiData[chan].notes <= 0 || !settings.channelsEnabled[chan]) {
 				continue;
 			}
 
-			auto& nesChannels2 = assignData.getNesData(chan2).nesChannels;
-			auto commonChannels = nesChannels & nesChannels2;
-			if (commonChannels.any() && midiData[chan].interruptingNotes[chan2] > 0) {
-				return true;
+			for (AssignChannelData const& configuration : channelConfigurations[chan]) {
+				if (isBudgetSpent) {
+					return;
+				}
+
+				AssignData newData = workingData.data;
+				newData.assign(chan, configuration);
+
+				if (!visit(checked, newData)) {
+					stats.addDuplicate();
+					continue;
+				}
+
+				AssignScorer::ScoredData scoredData = rescore(workingData, newData, chan);
+				replaceIfBetter(scoredData, false);
+				spendNode();
+
+				tryUnassignSomeChannels(scoredData, depth, checked);
 			}
 		}
 
-		return false;
+		tryUnassignSomeChannels(workingData, depth, checked);
 	}
 
-	static int getAssignConfigurationId(Preset::Duty duty, Preset::Channel channel, bool isSimpleLoop, int maxChannelCount) {
-		return int(duty) // 3b
-			+ (int(channel) << 3) // 3b
-			+ (int(isSimpleLoop) << 6) // 1b
-			+ (min(4, maxChannelCount) << 7); // 3b
+	void searchDepthFirst() {
+		while (!isBudgetSpent) {
+			stats.addRound();
+			double oldScore = bestData.score;
+			// the top level continues from bestData as soon as it improves
+			tryAssignSomeChannels(bestData, settings.searchDepth, visited);
+			if (bestData.score <= oldScore) {
+				break;
+			}
+		}
 	}
 
-	std::vector<AssignChannelData> getMelodicAssignConfigurations(Preset::Duty duty, bool isSimpleLoop, int maxChannelCount) const {
-		using enum Preset::Duty;
-		using enum NesChannel;
-		std::vector<AssignChannelData> results;
+	// copies the section of owner to a branch assigner, the branches only read it
+	void startBranches(ChannelAssigner const& owner) {
+		midiData = owner.midiData;
+		channelConfigurations = owner.channelConfigurations;
+		scorer.emplace(*owner.scorer);
+		deadline = owner.deadline;
+		sharedVisited = &owner.visited;
+		stats = Stats();
+		stats.startSection(owner.eventIndex, owner.pass);
+	}
 
-		if (maxChannelCount <= 0) {
-			return results;
+	// the depth first search below one move from start, start and the move are already in sharedVisited
+	// the result depends only on start, the move and sharedVisited, not on the branches searched before by the same assigner
+	AssignScorer::ScoredData searchBranch(AssignScorer::ScoredData const& start, Move const& move, int budget, AssignDataSet& checked) {
+		checked.clear();
+		bestData = start;
+		searchedNodes = 0;
+		nodeBudget = budget;
+		isBudgetSpent = false;
+
+		AssignScorer::ScoredData scoredData = rescore(start, move.data, move.chan);
+		replaceIfBetter(scoredData, false);
+		spendNode();
+		if (move.isAssign) {
+			tryUnassignSomeChannels(scoredData, settings.searchDepth - 1, checked);
 		}
-
-		results.push_back(AssignChannelData(duty, { PULSE2 }));
-		results.push_back(AssignChannelData(duty, { PULSE1 }));
-		if (maxChannelCount >= 2) {
-			results.push_back(AssignChannelData(duty, { PULSE1, PULSE2 }));
+		else {
+			tryAssignSomeChannels(scoredData, settings.searchDepth - 2, checked);
 		}
+		return bestData;
+	}
 
-		if (settings.useVrc6) {
-			results.push_back(AssignChannelData(duty, { PULSE4 }));
-			results.push_back(AssignChannelData(duty, { PULSE3 }));
-			if (maxChannelCount >= 2) {
-				results.push_back(AssignChannelData(duty, { PULSE3, PULSE4 }));
-				results.push_back(AssignChannelData(duty, { PULSE2, PULSE4 }));
-				results.push_back(AssignChannelData(duty, { PULSE2, PULSE3 }));
-				results.push_back(AssignChannelData(duty, { PULSE1, PULSE4 }));
-				results.push_back(AssignChannelData(duty, { PULSE1, PULSE3 }));
-			}
-			if (maxChannelCount >= 3) {
-				results.push_back(AssignChannelData(duty, { PULSE2, PULSE3, PULSE4 }));
-				results.push_back(AssignChannelData(duty, { PULSE1, PULSE3, PULSE4 }));
-				results.push_back(AssignChannelData(duty, { PULSE1, PULSE2, PULSE4 }));
-				results.push_back(AssignChannelData(duty, { PULSE1, PULSE2, PULSE3 }));
-			}
-			if (maxChannelCount >= 4) {
-				results.push_back(AssignChannelData(duty, { PULSE1, PULSE2, PULSE3, PULSE4 }));
+	// searches the branches of one wave, each on its own set of visited states, and reduces them in the order of the moves
+	void searchWave(AssignScorer::ScoredData const& start, std::vector<Move> const& wave, int branchBudget) {
+		std::array<AssignScorer::ScoredData, SPLIT_WAVE_MOVES> branchResults;
+		std::array<int, SPLIT_WAVE_MOVES> branchNodes{};
+		std::array<bool, SPLIT_WAVE_MOVES> branchSpent{};
+		std::array<std::exception_ptr, SPLIT_WAVE_MOVES> errors;
+		std::atomic<size_t> nextBranch = 0;
+		auto worker = [&start, &wave, &branchResults, &branchNodes, &branchSpent, &errors, &nextBranch, branchBudget, this](ChannelAssigner& branchAssigner) {
+			for (size_t i = nextBranch++; i < wave.size(); i = nextBranch++) {
+				try {
+					branchResults[i] = branchAssigner.searchBranch(start, wave[i], branchBudget, waveVisited[i]);
+					branchNodes[i] = branchAssigner.searchedNodes;
+					branchSpent[i] = branchAssigner.isBudgetSpent;
+				}
+				catch (...) {
+					errors[i] = std::current_exception();
+				}
 			}
+		};
 
-			results.push_back(AssignChannelData(UNSPECIFIED, { SAWTOOTH }));
+		{
+			std::vector<std::jthread> workers;
+			for (size_t i = 1; i < min(branchAssigners.size(), wave.size()); i++) {
+				workers.emplace_back(worker, std::ref(*branchAssigners[i]));
+			}
+			worker(*branchAssigners[0]);
 		}
 
-		// cannot use triangle to play i.e. piano, because triangle does not decay
-		if (isSimpleLoop) {
-			results.push_back(AssignChannelData(UNSPECIFIED, { TRIANGLE }));
+		for (auto const& error : errors) {
+			if (error) {
+				std::rethrow_exception(error);
+			}
 		}
 
-		return results;
+		for (size_t i = 0; i < wave.size(); i++) {
+			replaceIfBetter(branchResults[i], false);
+			searchedNodes += branchNodes[i];
+			isBudgetSpent = isBudgetSpent || branchSpent[i];
+			visited.insertAll(waveVisited[i]);
+		}
 	}
 
-	std::vector<AssignChannelData> getAssignConfigurations(Preset::Duty duty, Preset::Channel channel, bool isSimpleLoop, int maxChannelCount) const {
-		switch (channel) {
-		case Preset::Channel::PULSE:
-		case Preset::Channel::TRIANGLE:
-		case Preset::Channel::SAWTOOTH:
-			return getMelodicAssignConfigurations(duty, isSimpleLoop, maxChannelCount);
-		case Preset::Channel::NOISE:
-			return { AssignChannelData(duty, { NesChannel::NOISE }) };
-		case Preset::Channel::DPCM:
-			return { AssignChannelData(duty, { NesChannel::DPCM }) };
-		default:
-			return {};
+	// every round takes the moves from bestData in waves of SPLIT_WAVE_MOVES branches, the branches of a wave are searched by searchThreadCount workers
+	// a branch skips the states visited before its wave, the result does not depend on the thread count
+	// like searchDepthFirst the top level continues from bestData once it improves, here after the wave that improved it
+	// the branches of a wave overlap, so about SPLIT_WAVE_MOVES times more states are scored than by searchDepthFirst, and the result differs from it
+	void searchDepthFirstSplit() {
+		if (settings.searchDepth <= 0) {
+			return;
+		}
+		while (branchAssigners.size() < size_t(searchThreadCount)) {
+			branchAssigners.push_back(std::make_unique<ChannelAssigner>(instrumentBase, settings, assignCache));
+		}
+		for (auto& branchAssigner : branchAssigners) {
+			branchAssigner->startBranches(*this);
 		}
-	}
 
-	const std::vector<AssignChannelData>& getAssignConfigurations(Preset const& preset, int maxChannelCount) const {
-		return assignConfigurationLookup[getAssignConfigurationId(preset.duty, preset.channel, preset.isSimpleLoop(), maxChannelCount)];
-	}
+		std::vector<Move> moves;
+		std::vector<Move> wave;
+		while (!isBudgetSpent) {
+			stats.addRound();
+			stats.addExpandedNode();
+			double oldScore = bestData.score;
+			AssignScorer::ScoredData start = bestData;
 
-	void replaceIfBetter(AssignData const& assignData, bool includeDutyDiversity) {
-		double newScore = calculateScore(assignData);
-		if (includeDutyDiversity) {
-			newScore *= getDutyDiversityScore(assignData);
+			moves.clear();
+			forEachMove(start.data, [&moves, this](AssignData const& newData, int chan, bool isAssign) {
+				// like searchDepthFirst, unassigning is the second level of a move
+				if (isAssign || settings.searchDepth >= 2) {
+					moves.push_back({ newData, chan, isAssign });
+				}
+			});
+
+			// the remaining node budget is split evenly, so the branches do not depend on each other
+			int branchBudget = nodeBudget > 0 ? max(1, (nodeBudget - searchedNodes) / max(1, int(moves.size()))) : 0;
+			auto nextMove = moves.begin();
+			while (nextMove != moves.end() && !isBudgetSpent && bestData.score <= oldScore) {
+				// moves become visited when their wave starts, the moves after an improving wave are left to the next rounds
+				wave.clear();
+				for (; nextMove != moves.end() && wave.size() < SPLIT_WAVE_MOVES; ++nextMove) {
+					if (visited.insert(nextMove->data)) {
+						wave.push_back(*nextMove);
+					}
+					else {
+						stats.addDuplicate();
+					}
+				}
+				searchWave(start, wave, branchBudget);
+			}
+
+			if (bestData.score <= oldScore) {
+				break;
+			}
 		}
 
-		if (newScore > bestData.score) {
-			bestData.data = assignData;
-			bestData.score = newScore;
+		for (auto const& branchAssigner : branchAssigners) {
+			stats.addBranch(branchAssigner->stats);
 		}
 	}
 
-	void tryUnassignSomeChannels(AssignData const& workingData, int depth, std::unordered_set<AssignData>& checked) {
+	// states one move away - assigning one configuration or unassigning one NES channel, in the order of the depth first search
+	template<typename Callable> void forEachMove(AssignData const& assignData, Callable action) const {
+		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			if (midiData[chan].notes <= 0 || !settings.channelsEnabled[chan]) {
+				continue;
+			}
 
-		if (depth == 0) {
-			return;
+			for (AssignChannelData const& configuration : channelConfigurations[chan]) {
+				AssignData newData = assignData;
+				newData.assign(chan, configuration);
+				action(newData, chan, true);
+			}
 		}
-		depth--;
 
 		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
 			if (midiData[chan].notes <= 0 || !settings.channelsEnabled[chan]) {
 				continue;
 			}
 
-			workingData.getNesData(chan).forEachAssignedChannel([&workingData, depth, &checked, chan, this](NesChannel nesChannel) {
-				AssignData newData = workingData;
+			assignData.getNesData(chan).forEachAssignedChannel([&assignData, &action, chan](NesChannel nesChannel) {
+				AssignData newData = assignData;
 				newData.unassign(chan, nesChannel);
+				action(newData, chan, false);
+			});
+		}
+	}
 
-				if (!checked.insert(newData).second) {
-					return;
-				}
+	// keeps the searchBeamWidth best states of every level, stops after searchDepth levels without improvement
+	void searchBeam() {
+		std::vector<AssignScorer::ScoredData> beam{ bestData };
+		std::vector<AssignScorer::ScoredData> children;
+		std::vector<int> order;
+		int levelsWithoutImprovement = 0;
 
-				replaceIfBetter(newData, false);
+		while (!beam.empty() && levelsWithoutImprovement < settings.searchDepth && !isBudgetSpent) {
+			stats.addRound();
+			double oldScore = bestData.score;
 
-				tryAssignSomeChannels(newData, depth, checked);
-			});
-		}
+			children.clear();
+			for (auto const& state : beam) {
+				stats.addExpandedNode();
+				forEachMove(state.data, [&state, &children, this](AssignData const& newData, int chan, bool) {
+					if (isBudgetSpent) {
+						return;
+					}
+					if (!visited.insert(newData)) {
+						stats.addDuplicate();
+						return;
+					}
+
+					children.push_back(rescore(state, newData, chan));
+					replaceIfBetter(children.back(), false);
+					spendNode();
+				});
+			}
 
-		tryAssignSomeChannels(workingData, depth, checked);
-	}
+			// equal scores keep the order of generation, so the beam does not depend on the sort implementation
+			order.resize(children.size());
+			std::iota(order.begin(), order.end(), 0);
+			auto beamEnd = order.begin() + min(order.size(), size_t(max(1, settings.searchBeamWidth)));
+			std::partial_sort(order.begin(), beamEnd, order.end(), [&children](int a, int b) {
+				return children[a].score > children[b].score || (children[a].score == children[b].score && a < b);
+			});
 
-	void tryAssignSomeChannels(AssignData const& workingData, int depth, std::unordered_set<AssignData>& checked) {
+			beam.clear();
+			for (auto it = order.begin(); it != beamEnd; ++it) {
+				beam.push_back(children[*it]);
+			}
 
-		if (depth == 0) {
-			return;
+			levelsWithoutImprovement = bestData.score > oldScore ? 0 : levelsWithoutImprovement + 1;
 		}
-		depth--;
+	}
+
+	// every value the moves can give a channel - the configurations, and subsets of the initial value left by unassigning
+	// the configurations are closed under subsets, so unassigning adds no other values
+	void fillChannelDomains(AssignData const& initData) {
+		exactOrder.clear();
+		std::array<double, MidiState::CHANNEL_COUNT> bestScores{};
 
 		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			auto& domain = channelDomains[chan];
+			domain.clear();
 			if (midiData[chan].notes <= 0 || !settings.channelsEnabled[chan]) {
 				continue;
 			}
 
-			std::optional<Preset> preset = instrumentBase.getGmPreset(programs[chan]);
-			if (!preset) {
-				continue;
+			AssignChannelData initValue = initData.getNesData(chan);
+			auto initMask = uint8_t(initValue.nesChannels.to_ulong());
+			for (uint8_t mask = initMask; ; mask = (mask - 1) & initMask) {
+				domain.push_back(AssignChannelData(initValue.duty, std::bitset<int(NesChannel::CHANNEL_COUNT)>(mask)));
+				if (mask == 0) {
+					break;
+				}
 			}
-
-			auto maxChannelCount = min(int(midiData[chan].noteCountAtNotesOn.size()), settings.maxNesChannels[chan]);
-			for (AssignChannelData const& configuration : getAssignConfigurations(preset.value(), maxChannelCount)) {
-				if ((configuration.nesChannels & settings.allowedNesChannels[chan]) != configuration.nesChannels) {
-					continue;
+			for (AssignChannelData const& configuration : channelConfigurations[chan]) {
+				if (std::ranges::find(domain, configuration) == domain.end()) {
+					domain.push_back(configuration);
 				}
+			}
 
-				AssignData newData = workingData;
-				newData.assign(chan, configuration);
+			// good values first, so a good state is found early and prunes the rest
+			std::ranges::stable_sort(domain, std::greater<>(), [chan, this](AssignChannelData const& value) { return scorer->getUninterruptedScore(chan, value); });
+			bestScores[chan] = max(0.0, scorer->getUninterruptedScore(chan, domain.front()));
+			exactOrder.push_back(chan);
+		}
 
-				if (!checked.insert(newData).second) {
-					continue;
-				}
+		// channels with high scores first tighten the bound sooner
+		std::ranges::stable_sort(exactOrder, std::greater<>(), [&bestScores](int chan) { return bestScores[chan]; });
 
-				replaceIfBetter(newData, false);
+		remainingScoreBounds.assign(exactOrder.size() + 1, 0);
+		remainingMultiplierBounds.assign(exactOrder.size() + 1, 1);
+		for (int i = int(exactOrder.size()) - 1; i >= 0; i--) {
+			int chan = exactOrder[i];
+			bool canMeetMinChannels = std::ranges::any_of(channelDomains[chan], [chan, this](AssignChannelData const& value) {
+				return int(value.nesChannels.count()) >= settings.minNesChannels[chan];
+			});
+			remainingScoreBounds[i] = remainingScoreBounds[i + 1] + bestScores[chan];
+			remainingMultiplierBounds[i] = remainingMultiplierBounds[i + 1] * (canMeetMinChannels ? 1 : AssignScorer::MIN_CHANNELS_MULTIPLIER);
+		}
+	}
 
-				tryUnassignSomeChannels(newData, depth, checked);
+	// channels exactOrder[index..] are empty in partialData, channels before them have their values
+	void branchAndBound(AssignScorer::ScoredData const& partialData, int index, double multiplier) {
+		if (size_t(index) == exactOrder.size()) {
+			replaceIfBetter(partialData, false);
+			return;
+		}
+
+		int chan = exactOrder[index];
+		stats.addExpandedNode();
+		for (AssignChannelData const& value : channelDomains[chan]) {
+			if (isBudgetSpent) {
+				return;
+			}
+
+			AssignData newData = partialData.data;
+			newData.assign(chan, value);
+			AssignScorer::ScoredData scoredData = rescore(partialData, newData, chan);
+			spendNode();
+
+			double newMultiplier = multiplier;
+			if (int(value.nesChannels.count()) < settings.minNesChannels[chan]) {
+				newMultiplier *= AssignScorer::MIN_CHANNELS_MULTIPLIER;
+			}
+
+			// channels valued later can only interrupt the valued ones, which sets their score to 0
+			double scoreBound = remainingScoreBounds[index + 1];
+			for (double channelScore : scoredData.channelScores) {
+				scoreBound += max(0.0, channelScore);
 			}
+			// a small margin keeps states whose score differs from the bound only by rounding
+			if (scoreBound * newMultiplier * remainingMultiplierBounds[index + 1] * (1 + 1e-9) <= bestData.score) {
+				continue;
+			}
+
+			branchAndBound(scoredData, index + 1, newMultiplier);
 		}
+	}
 
-		tryUnassignSomeChannels(workingData, depth, checked);
+	void searchExact() {
+		fillChannelDomains(bestData.data);
+		// the beam finds a good state quickly, the bound prunes against it from the first branch
+		searchBeam();
+
+		// channels outside exactOrder keep their initial values
+		AssignData partialData = bestData.data;
+		double multiplier = 1;
+		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			if (std::ranges::find(exactOrder, chan) != exactOrder.end()) {
+				partialData.reset(chan);
+			}
+			else if (std::popcount(partialData.getMask(chan)) < settings.minNesChannels[chan]) {
+				multiplier *= AssignScorer::MIN_CHANNELS_MULTIPLIER;
+			}
+		}
+
+		stats.addRound();
+		branchAndBound(scorer->score(partialData), 0, multiplier);
 	}
 
 	static double getDutyDiversityScore(AssignData const& assignData) {
@@ -274,27 +524,35 @@ private:
 		counts[1] = assignData.countPulseDuty(PULSE_25);
 		counts[2] = assignData.countPulseDuty(PULSE_50);
 
-		std::ranges::sort(counts);
+		return DutyBound::getDiversityScore(counts);
+	}
 
-		return 3 + counts[0] * 2 + counts[1];
+	// duties are diversed from the first channel up to the first channel without a pulse duty
+	static bool hasPulseDuty(AssignChannelData const& nesData) {
+		return nesData.nesChannels.any() && nesData.getChannel() == Preset::Channel::PULSE && nesData.duty != Preset::Duty::UNSPECIFIED;
 	}
 
-	void diverseDuty(AssignData const& workingData, int chan = 0) {
+	void diverseDuty(AssignScorer::ScoredData const& workingData, int chan = 0) {
 		using enum Preset::Duty;
 		if (chan >= MidiState::CHANNEL_COUNT) {
 			return;
 		}
 
-		if (const AssignChannelData& nesData = workingData.getNesData(chan); 
-			nesData.nesChannels.none() || nesData.getChannel() != Preset::Channel::PULSE || nesData.duty == UNSPECIFIED) {
+		if (!hasPulseDuty(workingData.data.getNesData(chan))) {
 			return;
 		}
 
 		for (Preset::Duty duty : {PULSE_12, PULSE_25, PULSE_50}) {
-			AssignData newData = workingData;
+			AssignData newData = workingData.data;
 			newData.setDuty(chan, duty);
-			replaceIfBetter(newData, true);
-			diverseDuty(newData, chan + 1);
+			AssignScorer::ScoredData scoredData = rescore(workingData, newData, chan);
+			replaceIfBetter(scoredData, true);
+
+			// no state below can replace bestData, so skipping it gives the same result as trying every duty
+			if (dutyBound->get(scoredData, chan) <= bestData.score) {
+				continue;
+			}
+			diverseDuty(scoredData, chan + 1);
 		}
 	}
 
@@ -304,79 +562,119 @@ private:
 		}
 	}
 
-	AssignData getCleanInitData() const {
-		AssignData ret = lastData.data;
+	void fillChannelConfigurations() {
 		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
-			if (programs[chan] != lastData.programs[chan]) {
-				ret.reset(chan);
+			channelConfigurations[chan].clear();
+
+			Preset const* preset = instrumentBase.getGmPreset(programs[chan]);
+			if (!preset) {
+				continue;
 			}
-		}
-		return ret;
-	}
 
-	static std::array<int, MidiState::CHANNEL_COUNT> getPrograms(MidiState const& midiState) {
-		std::array<int, MidiState::CHANNEL_COUNT> programs{};
-		for (int i = 0; i < programs.size(); i++) {
-			programs[i] = midiState.getChannel(i).program;
+			auto maxChannelCount = min(int(midiData[chan].noteCountAtNotesOn.size()), settings.maxNesChannels[chan]);
+			for (AssignChannelData const& configuration : assignConfigurations.getConfigurations(*preset, maxChannelCount)) {
+				if ((configuration.nesChannels & settings.allowedNesChannels[chan]) == configuration.nesChannels) {
+					channelConfigurations[chan].push_back(configuration);
+				}
+			}
 		}
-		return programs;
 	}
 
-	void initLookupsDeeper(Preset::Duty duty, Preset::Channel channel, bool isSimpleLoop) {
-		for (int maxChannelCount = 0; maxChannelCount <= 4; maxChannelCount++) {
-			assignConfigurationLookup[getAssignConfigurationId(duty, channel, isSimpleLoop, maxChannelCount)] = getAssignConfigurations(duty, channel, isSimpleLoop, maxChannelCount);
+	// searches the section in midiData from initData, the result has diversed duties
+	AssignData search(AssignData const& initData) {
+		stats.startSection(eventIndex, pass);
+		calculateMidiData();
+		std::string cacheKey = AssignCache::getKey(settingsHash, programs, initData, midiData);
+		if (std::optional<AssignData> cached = assignCache.find(cacheKey)) {
+			stats.setCacheHit();
+			stats.endSection();
+			return cached.value();
 		}
-	}
 
-	void initLookups() {
-		for (int dutyI = 0; dutyI < int(Preset::Duty::DUTY_COUNT); dutyI++) {
-			auto duty = Preset::Duty(dutyI);
+		fillChannelConfigurations();
+		scorer.emplace(instrumentBase, settings, midiData, programs);
+		bestData = scorer->score(initData);
+
+		visited.clear();
+		visited.insert(bestData.data);
+
+		// bestData always holds the best state found, so a spent budget only ends the search earlier
+		searchedNodes = 0;
+		nodeBudget = settings.searchNodeBudget;
+		isBudgetSpent = false;
+		deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(settings.searchTimeBudgetMs);
+
+		switch (settings.searchMode) {
+		case SearchMode::BEAM:
+			searchBeam();
+			break;
+		case SearchMode::EXACT:
+			searchExact();
+			break;
+		default:
+			if (searchThreadCount > 1) {
+				searchDepthFirstSplit();
+			}
+			else {
+				searchDepthFirst();
+			}
+			break;
+		}
 
-			for (int channelI = 0; channelI < int(Preset::Channel::CHANNEL_COUNT); channelI++) {
-				auto channel = Preset::Channel(channelI);
+		if (isBudgetSpent) {
+			std::cout << "Search budget spent after " << searchedNodes << " states" << std::endl;
+		}
 
-				for (int isSimpleLoopI = 0; isSimpleLoopI < 2; isSimpleLoopI++) {
-					auto isSimpleLoop = bool(isSimpleLoopI);
+		std::cout << "Diversing pulse duties..." << std::endl;
 
-					initLookupsDeeper(duty, channel, isSimpleLoop);
-				}
-			}
+		int diversedChannelCount = 0;
+		while (diversedChannelCount < MidiState::CHANNEL_COUNT && hasPulseDuty(bestData.data.getNesData(diversedChannelCount))) {
+			diversedChannelCount++;
 		}
+		dutyBound.emplace(*scorer, bestData, diversedChannelCount);
+
+		bestData.score = 0;
+		diverseDuty(bestData);
+		dutyBound.reset();
+		scorer.reset();
+		assignCache.insert(cacheKey, bestData.data);
+		stats.endSection();
+		return bestData.data;
 	}
 
 public:
-	explicit ChannelAssigner(InstrumentBase const& instrumentBase, FileSettingsJson const& settings) : instrumentBase(instrumentBase), settings(settings) {
-		initLookups();
-	}
+	ChannelAssigner(InstrumentBase const& instrumentBase, FileSettingsJson const& settings, AssignCache& assignCache) : instrumentBase(instrumentBase), settings(settings),
+		assignConfigurations(AssignConfigurationTable::get(settings.useVrc6)), assignCache(assignCache), settingsHash(AssignCache::hashSettings(settings)),
+		searchThreadCount(settings.searchThreads > 0 ? settings.searchThreads : max(1, int(std::thread::hardware_concurrency()))) {}
 
-	void addNote(MidiEvent const& event, MidiState const& currentState) {
-		midiData[event.chan].addNote(event, currentState);
+	void addNote(MidiEvent const& event, MidiTimeline::Cursor& timeline) {
+		midiData[event.chan].addNote(event, timeline);
 	}
 
-	IndexedAssignData generateAssignData(int newEventIndex, MidiState const& midiState) {
-		programs = getPrograms(midiState);
-		calculateMidiData();
-		bestData.data = getCleanInitData();
-		bestData.score = calculateScore(bestData.data);
-
-		std::unordered_set<AssignData> checked{ bestData.data };
-
-		while (true) {
-			double oldScore = bestData.score;
-			tryAssignSomeChannels(bestData.data, settings.searchDepth, checked);
-			if (bestData.score <= oldScore) {
-				break;
-			}
-		}
-
-		std::cout << "Diversing pulse duties..." << std::endl;
-
-		bestData.score = 0;
-		diverseDuty(bestData.data);
+	IndexedAssignData generateAssignData(int newEventIndex, std::array<int, MidiState::CHANNEL_COUNT> const& newPrograms) {
+		programs = newPrograms;
+		AssignData result = search(lastData.getCleanData(programs));
 
-		lastData = IndexedAssignData(bestData.data, eventIndex, programs);
+		lastData = IndexedAssignData(result, eventIndex, programs);
 		eventIndex = newEventIndex;
 		midiData = {};
 		return lastData;
 	}
+
+	// searches a section whose notes were collected elsewhere, the sections before it are only seen through initData
+	// sectionPass tells the stats of the searches of the same section apart
+	AssignData generateAssignData(int sectionEventIndex, int sectionPass, std::array<MidiChannelNotesData, MidiState::CHANNEL_COUNT> const& sectionMidiData,
+		std::array<int, MidiState::CHANNEL_COUNT> const& sectionPrograms, AssignData const& initData) {
+		eventIndex = sectionEventIndex;
+		pass = sectionPass;
+		midiData = sectionMidiData;
+		programs = sectionPrograms;
+		AssignData result = search(initData);
+		midiData = {};
+		return result;
+	}
+
+	Stats const& getStats() const {
+		return stats;
+	}
 };
\ No newline at end of file
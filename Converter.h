@@ -3,9 +3,11 @@
 #include "FamiTrackerFile.h"
 #include "InstrumentSelector.h"
 #include "MidiState.h"
+#include "MidiTimeline.h"
 #include "NesState.h"
 #include "PitchCalculator.h"
-#include "MidiEventParser.h"
+#include "EventStore.h"
+#include "TempoAligner.h"
 #include "NesHeightVolumeController.h"
 #include "FileSettingsJson.h"
 
@@ -14,12 +16,13 @@ private:
     std::array<double, int(NesChannel::CHANNEL_COUNT)> nesVolumeFactor = { 0.7, 0.7, 1.0, 1.0, 1.0, 0.7, 0.7, 0.7 };
 
     const FileSettingsJson& settings;
+    const FamiTrackerFile& file; // only global settings are read, the other tracks are converted at the same time
 
     InstrumentSelector instrumentSelector;
-    FamiTrackerFile file;
     std::shared_ptr<Track> track;
 
-    MidiState midiState;
+    MidiTimeline midiTimeline;
+    MidiTimeline::Cursor midiState{ midiTimeline };
     NesState nesState = NesState(60);
 
     std::shared_ptr<Pattern> getPattern(int pattern) {
@@ -47,7 +50,7 @@ private:
 
 		// ignore if already stopped
         if (stopType == Cell::Type::RELEASE) {
-            if (!note || !note->playing || !note->triggerData.preset.needRelease) { // the last condition causes that note has playing=true after release, but that's fine
+            if (!note || !note->playing || !note->triggerData.preset->needRelease) { // the last condition causes that note has playing=true after release, but that's fine
                 return;
 			}
 			nesState.releaseNote(nesChannel);
@@ -99,11 +102,11 @@ private:
         auto triggerData = instrumentSelector.getNoteTriggers(event, eventIndex, midiState.getChannel(event.chan), nesState, settings);
 
         for (auto& data : triggerData) {
-            double canInterruptSeconds = nesState.seconds + data.preset.uninterruptedTicks / 60.0;
+            double canInterruptSeconds = nesState.seconds + data.preset->uninterruptedTicks / 60.0;
             nesState.setNote(data.nesChannel, PlayingNesNote(event, nesState.seconds, data, canInterruptSeconds));
 
             Cell& currentCell = getCurrentCell(data.nesChannel);
-            currentCell.Note(data.preset.note ? data.preset.note.value() : Note(data.nesChannel, event.key), data.preset.instrument);
+            currentCell.Note(data.preset->note ? data.preset->note.value() : Note(data.nesChannel, event.key), data.preset->instrument);
 
             // optional was set above, so shouldn't be empty
             setNesPitchAndVolume(event.chan, data.nesChannel, nesState.getNote(data.nesChannel).value());
@@ -177,7 +180,7 @@ private:
                     return;
                 }
 
-                getCurrentCell(nesChannel).Note(Note(nesChannel, key), note.triggerData.preset.instrument);
+                getCurrentCell(nesChannel).Note(Note(nesChannel, key), note.triggerData.preset->instrument);
                 note.keyAfterPitch = key;
                 setNesPitchAndVolume(midiChan, nesChannel, note);
             }
@@ -232,10 +235,10 @@ private:
         }
     }
 
-    void processEvents(std::vector<MidiEvent> const& events) {
+    void processEvents(EventStore const& events) {
         int prevRow = nesState.getRow();
         for (int i = 0; i < events.size(); i++) {
-			MidiEvent const& event = events[i];
+			MidiEvent const event = events[i];
             nesState.seconds = event.seconds;
 
             int newRow = nesState.getRow() - 2; // decremented because of muting previous row on note
@@ -244,7 +247,7 @@ private:
             }
             prevRow = nesState.getRow();
 
-            midiState.processEvent(event);
+            midiState.moveTo(i);
 
             switch (event.event) {
             case MIDI_EVENT_NOTE_ON:
@@ -297,67 +300,16 @@ private:
         return divider;
     }
 
-    double getAdjustedTempoScore(std::vector<MidiEvent> const& events, double speed, double secondsLimit) {
-        double score = 0;
-        for (auto& event : events) {
-            if (event.event != MIDI_EVENT_NOTE_ON) {
-                continue;
-            }
-            if (event.seconds > secondsLimit) {
-                break;
-            }
+    void adjustTempo(EventStore& events, TempoMap const& tempoMap, double songStart, double songLength) {
+        std::vector<EventStore::SpeedSection> sections = TempoAligner(events, tempoMap, songStart, songLength, settings.adjustSpeedSections).fit(nesState.rowsPerSecond, settings.adjustSpeedMode, settings.adjustSpeedThreads);
 
-            double seconds = event.seconds * speed;
-            int row = nesState.getRow(seconds);
-            double resultSeconds = nesState.getSeconds(row);
-            score += max(0, 1 - std::abs(seconds - resultSeconds) * 30);
+        std::cout << (sections.size() == 1 ? "Speed multiplier: " : "Speed multipliers of tempo sections: ");
+        for (size_t i = 0; i < sections.size(); i++) {
+            std::cout << (i > 0 ? ", " : "") << sections[i].speed;
         }
+        std::cout << std::endl;
 
-        return score * max(0, 1 - std::abs(1 - speed) * 4);
-    }
-
-    double findBestAdjustedSpeed(std::vector<MidiEvent> const& events, double songLength) {
-        double bestSpeed = 1;
-
-        double secondsLimit = 10;
-
-        double speedMin = 0.8;
-        double speedMax = 1.2;
-        double speedStep = 1 / 10000.0;
-
-        while (true) {
-            double bestScore = -1;
-            double speed = speedMin;
-            while (speed <= speedMax) {
-                if (double score = getAdjustedTempoScore(events, speed, secondsLimit); score > bestScore) {
-                    bestScore = score;
-                    bestSpeed = speed;
-                }
-
-                speed += speedStep;
-            }
-
-            if (secondsLimit >= songLength) {
-                break;
-            }
-            secondsLimit *= 2;
-            speedStep *= 0.5;
-            speedMin = bestSpeed - 16 * speedStep;
-            speedMax = bestSpeed + 16 * speedStep;
-        }
-
-        return bestSpeed;
-    }
-
-    void adjustTempo(std::vector<MidiEvent>& events, double songLength) {
-        double speed = findBestAdjustedSpeed(events, songLength);
-
-        std::cout << "Speed multiplier: " << speed << std::endl;
-
-        for (auto& event : events) {
-            event.seconds *= speed;
-            event.noteEndSeconds *= speed;
-        }
+        events.changeSpeed(sections);
     }
 
     void mergeEmptyRows(int startRow, int endRow, int maxCount) {
@@ -379,22 +331,22 @@ private:
     }
 
 public:
-    explicit Converter(FileSettingsJson const& settings) : settings(settings) {}
+    Converter(FileSettingsJson const& settings, FamiTrackerFile const& file, InstrumentBase const& base, AssignCache& assignCache, std::shared_ptr<Track> track) :
+        settings(settings), file(file), instrumentSelector(base, assignCache), track(track) {}
 
-    FamiTrackerFile convert(HSTREAM handle) {
-        std::vector<MidiEvent> events = MidiEventParser::getEvents(handle);
-        double songLength = (events.empty() ? 0 : events.back().seconds);
+    // fills the track, instruments of the base must be already added to the file
+    // songStart is the position of the song in the tempo map of its MIDI file
+    void convert(EventStore events, TempoMap const& tempoMap, double songStart, SearchStats* stats = nullptr) {
+        double songLength = (events.empty() ? 0 : events.getSeconds(events.size() - 1));
 
         // slightly adjusts playing speed to make distances between notes even
         if (settings.adjustSpeed) {
-            adjustTempo(events, songLength);
+            adjustTempo(events, tempoMap, songStart, songLength);
         }
 
-        file.expansion = FamiTrackerFile::Expansion::VRC6;
-		file.comment = L"Created using MidiToFamiTrackerConverter by hakerg";
-        instrumentSelector.preprocess(events, file, settings);
+        midiTimeline = MidiTimeline(events);
+        instrumentSelector.preprocess(events, midiTimeline, settings, stats);
 
-        track = file.addTrack(settings.rowsPerPattern);
         track->speed = 1;
         track->tempo = 150;
 
@@ -406,7 +358,6 @@ public:
 
         getCurrentCell(NesChannel::DPCM).Halt();
 
-		std::cout << "Created " << track->patterns.size() << " patterns, " << file.instruments.size() << " instruments and " << file.dpcmSamples.size() << " DPCM samples" << std::endl;
-        return file;
+		std::cout << "Created " << track->patterns.size() << " patterns" << std::endl;
     }
 };
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+#include "commons.h"
+#include "MidiState.h"
+#include "AssignData.h"
+#include "AssignScorer.h"
+
+// upper bounds of the duty diversified score while the duties of channels 0..channelCount-1 are diversed
+// only the score of a channel depends on its duty and the diversity depends only on the duty counts,
+// so the best score sum of the later channels for every reachable duty count is filled once by DP from the last channel
+class DutyBound {
+private:
+	static constexpr std::array<Preset::Duty, 3> DUTIES = { Preset::Duty::PULSE_12, Preset::Duty::PULSE_25, Preset::Duty::PULSE_50 };
+	static constexpr double SLACK = 1e-9; // relative to the largest score, covers rounding of the sums
+
+	class Option {
+	public:
+		double score;
+		uint32_t count; // packed duty counts added by the option
+	};
+
+	int channelCount;
+	double multiplier;
+	double slack = 0;
+
+	// suffixBest[chan] - packed duty counts of channels chan..channelCount-1 and the best score sum giving them
+	std::vector<std::unordered_map<uint32_t, double>> suffixBest;
+
+	// counts of PULSE_12, PULSE_25, PULSE_50 packed by 8 bits
+	static int getDutyIndex(Preset::Duty duty) {
+		auto it = std::ranges::find(DUTIES, duty);
+		return it == DUTIES.end() ? -1 : int(it - DUTIES.begin());
+	}
+
+	static uint32_t getCount(AssignChannelData const& nesData) {
+		int dutyIndex = getDutyIndex(nesData.duty);
+		if (dutyIndex < 0 || nesData.getChannel() != Preset::Channel::PULSE) {
+			return 0;
+		}
+		return uint32_t(nesData.nesChannels.count()) << (8 * dutyIndex);
+	}
+
+	static double getDiversityScore(uint32_t counts) {
+		return getDiversityScore(std::array<double, 3>{ double(counts & 0xFF), double((counts >> 8) & 0xFF), double(counts >> 16) });
+	}
+
+public:
+	static double getDiversityScore(std::array<double, 3> counts) {
+		std::ranges::sort(counts);
+		return 3 + counts[0] * 2 + counts[1];
+	}
+
+	// scoredData is the state before diversing, its duties of the diversed channels are also possible for later channels
+	DutyBound(AssignScorer const& scorer, AssignScorer::ScoredData const& scoredData, int channelCount) : channelCount(channelCount),
+		multiplier(scorer.getMinChannelsMultiplier(scoredData.data)), suffixBest(size_t(channelCount) + 1) {
+
+		suffixBest[channelCount][0] = 0;
+		double maxScoreSum = 0;
+		uint32_t maxCount = 0;
+		for (int chan = channelCount; chan < MidiState::CHANNEL_COUNT; chan++) {
+			maxScoreSum += std::abs(scoredData.channelScores[chan]);
+			maxCount += uint32_t(scoredData.data.getNesData(chan).nesChannels.count());
+		}
+
+		for (int chan = channelCount - 1; chan >= 0; chan--) {
+			std::vector<Option> options;
+			double maxOptionScore = 0;
+			for (Preset::Duty duty : { DUTIES[0], DUTIES[1], DUTIES[2], scoredData.data.getDuty(chan) }) {
+				AssignData newData = scoredData.data;
+				newData.setDuty(chan, duty);
+				double score = scorer.rescore(scoredData, newData, chan).channelScores[chan];
+				options.push_back({ score, getCount(newData.getNesData(chan)) });
+				maxOptionScore = max(maxOptionScore, std::abs(score));
+			}
+			maxScoreSum += maxOptionScore;
+			maxCount += uint32_t(scoredData.data.getNesData(chan).nesChannels.count());
+
+			for (auto const& [count, best] : suffixBest[chan + 1]) {
+				for (Option const& option : options) {
+					auto [it, inserted] = suffixBest[chan].try_emplace(count + option.count, best + option.score);
+					it->second = max(it->second, best + option.score);
+				}
+			}
+		}
+
+		slack = SLACK * maxScoreSum * std::abs(multiplier) * (3 + 2 * double(maxCount));
+	}
+
+	// the highest score of states equal to scoredData except the duties of channels chan+1..channelCount-1
+	double get(AssignScorer::ScoredData const& scoredData, int chan) const {
+		double fixedScoreSum = 0;
+		uint32_t fixedCount = 0;
+		for (int chan2 = 0; chan2 < MidiState::CHANNEL_COUNT; chan2++) {
+			if (chan2 <= chan || chan2 >= channelCount) {
+				fixedScoreSum += scoredData.channelScores[chan2];
+				fixedCount += getCount(scoredData.data.getNesData(chan2));
+			}
+		}
+
+		double result = -std::numeric_limits<double>::infinity();
+		for (auto const& [count, best] : suffixBest[size_t(chan) + 1]) {
+			result = max(result, (fixedScoreSum + best) * multiplier * getDiversityScore(fixedCount + count));
+		}
+		return result + slack;
+	}
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include "commons.h"
+#include "MappedFile.h"
+#include "EventStore.h"
+#include "TempoMap.h"
+
+// on-disk copy of the linked, tempo-resolved events of a MIDI file, keyed by a hash of the file bytes
+// the file is the header followed by the raw arrays, so loading is a mapping and a few memcpy calls
+class EventCache {
+private:
+	static constexpr std::array<char, 8> MAGIC = { 'M', '2', 'F', 'T', 'E', 'V', 'T', 'S' };
+
+	class Header {
+	public:
+		std::array<char, 8> magic = MAGIC;
+		uint32_t parserVersion = 0;
+		int32_t division = 0;
+		uint64_t sourceHash = 0;
+		uint64_t sourceSize = 0;
+		uint64_t eventCount = 0;
+		uint64_t noteOnCount = 0;
+		uint64_t tempoSegmentCount = 0;
+	};
+
+	std::filesystem::path directory;
+	uint32_t parserVersion;
+
+	std::filesystem::path getPath(uint64_t sourceHash) const {
+		std::ostringstream name;
+		name << std::hex << std::setfill('0') << std::setw(16) << sourceHash << ".events";
+		return directory / name.str();
+	}
+
+	template<class T> static void copyArray(std::vector<T>& target, const uint8_t*& data, uint64_t count) {
+		target.resize(size_t(count));
+		if (count > 0) {
+			std::memcpy(target.data(), data, size_t(count) * sizeof(T));
+		}
+		data += count * sizeof(T);
+	}
+
+	template<class T> static void writeArray(std::ofstream& file, std::vector<T> const& source) {
+		file.write(reinterpret_cast<const char*>(source.data()), std::streamsize(source.size() * sizeof(T)));
+	}
+
+public:
+	EventCache(std::filesystem::path const& directory, uint32_t parserVersion) : directory(directory), parserVersion(parserVersion) {}
+
+	// unique among the threads of all processes writing to the cache, thread ids alone repeat between processes
+	static std::filesystem::path getTemporaryPath(std::filesystem::path const& path) {
+		std::random_device random;
+		uint64_t suffix = (uint64_t(random()) << 32) ^ random() ^ std::hash<std::thread::id>()(std::this_thread::get_id());
+		std::ostringstream name;
+		name << "." << std::hex << std::setfill('0') << std::setw(16) << suffix << ".tmp";
+
+		std::filesystem::path temporaryPath = path;
+		temporaryPath += name.str();
+		return temporaryPath;
+	}
+
+	// 64-bit multiply-xorshift hash, reads 8 bytes per step
+	static uint64_t hashBytes(const uint8_t* data, size_t size) {
+		constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15;
+		uint64_t hash = size * MULTIPLIER;
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			std::memcpy(&word, data + i, 8);
+			hash = (hash ^ word) * MULTIPLIER;
+			hash ^= hash >> 29;
+		}
+		uint64_t tail = 0;
+		std::memcpy(&tail, data + i, size - i);
+		hash = (hash ^ tail) * MULTIPLIER;
+		return hash ^ (hash >> 32);
+	}
+
+	// returns false when there is no entry, or it was written by a different parser version
+	bool load(uint64_t sourceHash, uint64_t sourceSize, EventStore& events, TempoMap& tempoMap) const {
+		std::filesystem::path path = getPath(sourceHash);
+		std::error_code error;
+		if (!std::filesystem::exists(path, error)) {
+			return false;
+		}
+
+		try {
+			MappedFile file(path);
+			Header header;
+			if (file.size() < sizeof(Header)) {
+				return false;
+			}
+			std::memcpy(&header, file.data(), sizeof(Header));
+			if (header.magic != MAGIC || header.parserVersion != parserVersion || header.sourceHash != sourceHash || header.sourceSize != sourceSize) {
+				return false;
+			}
+
+			uint64_t expectedSize = sizeof(Header) + header.eventCount * (sizeof(EventStore::PackedEvent) + sizeof(double)) +
+				header.noteOnCount * sizeof(double) + header.tempoSegmentCount * sizeof(TempoMap::Segment);
+			if (file.size() != expectedSize || header.tempoSegmentCount == 0) {
+				return false;
+			}
+
+			const uint8_t* data = file.data() + sizeof(Header);
+			copyArray(events.packed, data, header.eventCount);
+			copyArray(events.seconds, data, header.eventCount);
+			copyArray(events.noteEndSeconds, data, header.noteOnCount);
+			tempoMap.division = header.division;
+			copyArray(tempoMap.segments, data, header.tempoSegmentCount);
+			return true;
+		}
+		catch (std::exception const&) {
+			return false;
+		}
+	}
+
+	// written to a temporary file first, so concurrent conversions never see a partial entry
+	void store(uint64_t sourceHash, uint64_t sourceSize, EventStore const& events, TempoMap const& tempoMap) const {
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+
+		Header header;
+		header.parserVersion = parserVersion;
+		header.division = tempoMap.division;
+		header.sourceHash = sourceHash;
+		header.sourceSize = sourceSize;
+		header.eventCount = events.packed.size();
+		header.noteOnCount = events.noteEndSeconds.size();
+		header.tempoSegmentCount = tempoMap.segments.size();
+
+		std::filesystem::path path = getPath(sourceHash);
+		std::filesystem::path temporaryPath = getTemporaryPath(path);
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+			writeArray(file, events.packed);
+			writeArray(file, events.seconds);
+			writeArray(file, events.noteEndSeconds);
+			writeArray(file, tempoMap.segments);
+			if (!file) {
+				std::cout << "Cannot write event cache " << temporaryPath << std::endl;
+				return;
+			}
+		}
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error) {
+			std::filesystem::remove(temporaryPath, error);
+		}
+	}
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include "commons.h"
+#include "MidiEvent.h"
+
+// structure of arrays replacement for std::vector<MidiEvent>
+// passes that only need the type or time of an event read 8 or 16 bytes per event instead of a whole MidiEvent
+class EventStore {
+private:
+	friend class EventCache;
+
+	// 8 bytes per event, velocity is 0 and key is unused for non-note events
+	class PackedEvent {
+	public:
+		uint8_t type;
+		uint8_t chan;
+		uint8_t key;
+		uint8_t velocity;
+		uint32_t param; // index to noteEndSeconds for MIDI_EVENT_NOTE_ON
+
+		PackedEvent() = default;
+		PackedEvent(uint8_t type, uint8_t chan, uint8_t key, uint8_t velocity, uint32_t param) :
+			type(type), chan(chan), key(key), velocity(velocity), param(param) {}
+	};
+	static_assert(sizeof(PackedEvent) == 8);
+
+	std::vector<PackedEvent> packed;
+	std::vector<double> seconds;
+	std::vector<double> noteEndSeconds; // indexed only by note ons
+
+	// MIDI_EVENT_SYSTEMEX and MIDI_EVENT_END_TRACK are the only types above 8 bits
+	static uint8_t encodeType(uint32_t event) {
+		return event >= 0x10000 ? uint8_t(0xF0 | (event & 0x0F)) : uint8_t(event);
+	}
+
+	static uint32_t decodeType(uint8_t type) {
+		return type >= 0xF0 ? 0x10000 | (type & 0x0F) : type;
+	}
+
+	static bool isNote(uint32_t event) {
+		return event == MIDI_EVENT_NOTE_ON || event == MIDI_EVENT_NOTE_OFF || event == MIDI_EVENT_NOTE_STOP;
+	}
+
+public:
+	// seconds from start are multiplied by speed and counted from newStart
+	class SpeedSection {
+	public:
+		double start;
+		double newStart;
+		double speed;
+
+		SpeedSection(double start, double newStart, double speed) : start(start), newStart(newStart), speed(speed) {}
+
+		double getNewSeconds(double value) const {
+			return newStart + (value - start) * speed;
+		}
+	};
+
+	void reserve(size_t eventCount) {
+		packed.reserve(eventCount);
+		seconds.reserve(eventCount);
+	}
+
+	void add(MidiEvent const& event) {
+		uint32_t param = event.param;
+		if (event.event == MIDI_EVENT_NOTE_ON) {
+			param = uint32_t(noteEndSeconds.size());
+			noteEndSeconds.push_back(event.noteEndSeconds);
+		}
+		bool note = isNote(event.event);
+		packed.emplace_back(encodeType(event.event), uint8_t(event.chan), uint8_t(note ? event.key : 0), uint8_t(note ? max(0, event.velocity) : 0), param);
+		seconds.push_back(event.seconds);
+	}
+
+	int size() const {
+		return int(packed.size());
+	}
+
+	bool empty() const {
+		return packed.empty();
+	}
+
+	uint32_t getType(int index) const {
+		return decodeType(packed[index].type);
+	}
+
+	int getChan(int index) const {
+		return packed[index].chan;
+	}
+
+	int getKey(int index) const {
+		return packed[index].key;
+	}
+
+	double getSeconds(int index) const {
+		return seconds[index];
+	}
+
+	// only for MIDI_EVENT_NOTE_ON
+	double getNoteEndSeconds(int index) const {
+		return noteEndSeconds[packed[index].param];
+	}
+
+	// only for MIDI_EVENT_NOTE_ON
+	void linkNoteEnd(int noteOnIndex, int noteEndIndex) {
+		noteEndSeconds[packed[noteOnIndex].param] = seconds[noteEndIndex];
+	}
+
+	// rebuilds the full event, the original note param is restored from key and velocity
+	MidiEvent operator [] (int index) const {
+		PackedEvent const& event = packed[index];
+		uint32_t type = decodeType(event.type);
+		if (!isNote(type)) {
+			return MidiEvent(type, event.param, event.chan, seconds[index]);
+		}
+
+		double noteEnd = type == MIDI_EVENT_NOTE_ON ? noteEndSeconds[event.param] : seconds[index];
+		return MidiEvent(type, uint32_t(event.key | (event.velocity << 8)), event.chan, seconds[index], noteEnd, event.key, event.velocity);
+	}
+
+	// MIDI_EVENT_END closes every song, format 2 files have one per track
+	// each song starts at 0 seconds, counted from the end of the previous song
+	std::vector<EventStore> splitSongs() const {
+		std::vector<EventStore> songs(1);
+		double startSeconds = 0;
+		for (int i = 0; i < size(); i++) {
+			MidiEvent event = (*this)[i];
+			event.seconds -= startSeconds;
+			event.noteEndSeconds -= startSeconds;
+			songs.back().add(event);
+
+			if (event.event == MIDI_EVENT_END && i + 1 < size()) {
+				startSeconds = seconds[i];
+				songs.emplace_back();
+			}
+		}
+		return songs;
+	}
+
+	// piecewise linear time change, sections are sorted by start and the first one starts at 0
+	void changeSpeed(std::vector<SpeedSection> const& sections) {
+		auto getSection = [&sections](double value) -> SpeedSection const& {
+			return *(std::upper_bound(sections.begin() + 1, sections.end(), value, [](double value_, SpeedSection const& section) { return value_ < section.start; }) - 1);
+		};
+
+		for (double& value : seconds) {
+			value = getSection(value).getNewSeconds(value);
+		}
+		for (double& value : noteEndSeconds) {
+			value = getSection(value).getNewSeconds(value);
+		}
+	}
+};
@@ -92,10 +92,10 @@ public:
         return tracks.back();
     }
 
-    void exportTxt(std::wstring const& path) const {
+    void exportTxt(std::filesystem::path const& path) const {
         std::wofstream file(path);
         if (!file.is_open()) {
-            std::wcout << "Failed to open file " << path << std::endl;
+            std::cout << "Failed to open file " << path << std::endl;
             return;
         }
 
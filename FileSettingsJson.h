@@ -5,6 +5,25 @@
 #include "Note.h"
 #include "Preset.h"
 
+// grid searches every speed step, histogram scores only speeds estimated from note on intervals
+enum class AdjustSpeedMode { GRID, HISTOGRAM };
+
+NLOHMANN_JSON_SERIALIZE_ENUM(AdjustSpeedMode, {
+	{ AdjustSpeedMode::GRID, "grid" },
+	{ AdjustSpeedMode::HISTOGRAM, "histogram" },
+})
+
+// dfs searches every state up to search_depth moves away, beam keeps only the best states of every level
+// exact is a branch and bound over the values of all MIDI channels, it finds the best state at an exponential worst case
+// exact can be slower than dfs, it is meant to be used with search_node_budget or search_time_budget_ms
+enum class SearchMode { DFS, BEAM, EXACT };
+
+NLOHMANN_JSON_SERIALIZE_ENUM(SearchMode, {
+	{ SearchMode::DFS, "dfs" },
+	{ SearchMode::BEAM, "beam" },
+	{ SearchMode::EXACT, "exact" },
+})
+
 class FileSettingsJson {
 private:
 	template<class T> void load(T& value, std::string const& name) {
@@ -30,9 +49,18 @@ public:
 
 	bool useVrc6 = true;
 	int searchDepth = 8;
+	SearchMode searchMode = SearchMode::DFS;
+	int searchBeamWidth = 64;
+	int searchNodeBudget = 0; // scored states per section, 0 - unlimited
+	int searchTimeBudgetMs = 0; // per section, 0 - unlimited
+	int searchThreads = 1; // more splits the dfs moves of every round between threads, the result does not depend on their count but differs from one thread, 0 - all hardware threads
+	int assignThreads = 1; // more searches the sections speculatively in parallel and again until their starts agree, the result is the same as from one thread, 0 - all hardware threads
 	int rowsPerPattern = 256;
 	double maxDetuneSemitones = 0.125;
 	bool adjustSpeed = true;
+	AdjustSpeedMode adjustSpeedMode = AdjustSpeedMode::GRID;
+	bool adjustSpeedSections = false; // a separate speed for every tempo section, more rows on the tested songs
+	int adjustSpeedThreads = 1; // files are already converted on separate threads, 0 - all hardware threads
 	bool mergeEmptyRows = true;
 	double minDetuneHz = 0.5;
 	bool preemptiveNoteCut = true;
@@ -47,7 +75,7 @@ public:
 
 	std::array<std::bitset<int(NesChannel::CHANNEL_COUNT)>, MidiState::CHANNEL_COUNT> allowedNesChannels{};
 
-	explicit FileSettingsJson(std::wstring const& path) {
+	explicit FileSettingsJson(std::filesystem::path const& path) {
 		channelsEnabled.fill(true);
 		detuneSemitones.fill(0);
 		volumeMultiplier.fill(1);
@@ -67,9 +95,18 @@ public:
 
 		load(useVrc6, "use_vrc6");
 		load(searchDepth, "search_depth");
+		load(searchMode, "search_mode");
+		load(searchBeamWidth, "search_beam_width");
+		load(searchNodeBudget, "search_node_budget");
+		load(searchTimeBudgetMs, "search_time_budget_ms");
+		load(searchThreads, "search_threads");
+		load(assignThreads, "assign_threads");
 		load(rowsPerPattern, "rows_per_pattern");
 		load(maxDetuneSemitones, "max_detune_semitones");
 		load(adjustSpeed, "adjust_speed");
+		load(adjustSpeedMode, "adjust_speed_mode");
+		load(adjustSpeedThreads, "adjust_speed_threads");
+		load(adjustSpeedSections, "adjust_speed_sections");
 		load(mergeEmptyRows, "merge_empty_rows");
 		load(minDetuneHz, "min_detune_hz");
 		load(preemptiveNoteCut, "preemptive_note_cut");
@@ -134,6 +134,10 @@ private:
 	std::array<std::optional<Preset>, MidiState::PROGRAM_COUNT> gm;
 	std::unordered_map<int, std::array<std::optional<Preset>, MidiState::KEY_COUNT>> drums{};
 
+	// filled once the presets are complete, lookups do not copy presets or touch their shared_ptr refcounts
+	std::array<Preset const*, MidiState::PROGRAM_COUNT> gmTable{};
+	std::array<std::array<Preset const*, MidiState::KEY_COUNT>, MidiState::PROGRAM_COUNT> drumTable{}; // [program][key], programs without drums use program 0
+
 	std::vector<int> createDecayValues(int start, int last, int delta, int period) {
 		std::vector<int> values;
 		for (int i = start; i != last + delta; i += delta) {
@@ -435,6 +439,20 @@ private:
 		}
 	}
 
+	static Preset const* getPresetPointer(std::optional<Preset> const& preset) {
+		return preset ? &preset.value() : nullptr;
+	}
+
+	// gm and drums are not modified later, so the pointers stay valid
+	void fillTables() {
+		std::ranges::transform(gm, gmTable.begin(), &getPresetPointer);
+		for (int program = 0; program < MidiState::PROGRAM_COUNT; program++) {
+			auto it = drums.find(program);
+			auto const& keys = it != drums.end() ? it->second : drums.at(0);
+			std::ranges::transform(keys, drumTable[program].begin(), &getPresetPointer);
+		}
+	}
+
 	void bindDrumSample(std::shared_ptr<DpcmSample> sample, std::shared_ptr<Instrument> instrument, bool needRelease, int program, int key, Preset::Order order, int pitch) {
 		instrument->dpcmSamples.emplace_back(Note(NesChannel::DPCM, key), sample, pitch, false);
 		drums[program][key] = { Preset(Preset::Channel::DPCM, instrument, needRelease, Preset::Duty::UNSPECIFIED, order, Note(NesChannel::DPCM, key)) };
@@ -445,16 +463,23 @@ private:
 	}
 
 public:
+	InstrumentBase() = default;
+	// gmTable and drumTable point into gm and drums, a copy would point into the original
+	InstrumentBase(InstrumentBase const&) = delete;
+	InstrumentBase& operator=(InstrumentBase const&) = delete;
+
 	void fillBase(FamiTrackerFile& file) {
 		dpcm.samples.loadSamples(file);
 		fillInstruments(file);
+		fillTables();
 	}
 
-	std::optional<Preset> getGmPreset(int program) const {
-		return gm[program];
+	// nullptr if the program has no preset, the preset lives as long as the base
+	Preset const* getGmPreset(int program) const {
+		return gmTable[program];
 	}
 
-	std::optional<Preset> getDrumPreset(int program, int key) const {
-		return getMapValueOrDefault(drums, program, drums.find(0)->second)[key];
+	Preset const* getDrumPreset(int program, int key) const {
+		return drumTable[program][key];
 	}
 };
\ No newline at end of file
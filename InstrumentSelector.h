@@ -9,71 +9,196 @@
 #include "PlayScore.h"
 #include "AssignData.h"
 #include "ChannelAssigner.h"
+#include "EventStore.h"
+#include "MidiTimeline.h"
 
 class InstrumentSelector {
 private:
 	static constexpr double MIN_NOTE_SECONDS = 1 / 20.0; // 3 frames
+	static constexpr int MAX_ASSIGN_STEPS = 4; // sections walked by getAssign before it searches
 
-	InstrumentBase base;
-	std::vector<IndexedAssignData> channelAssignData{};
+	// notes of one section, collected before the sections are searched in parallel
+	class Section {
+	public:
+		std::array<MidiChannelNotesData, MidiState::CHANNEL_COUNT> midiData{};
+		std::array<int, MidiState::CHANNEL_COUNT> programs{};
+		int eventIndex = 0; // the first event of the section
+	};
 
-	static std::unordered_set<int> getSplitEventIndexes(std::vector<MidiEvent> const& events) {
-		std::unordered_set<int> splits;
-		MidiState state;
+	const InstrumentBase& base; // shared by all tracks of the file, read only
+	AssignCache& assignCache; // shared by all conversions of the process
+	std::vector<IndexedAssignData> channelAssignData{}; // sorted by eventIndex, the first section starts at 0
+	size_t assignPosition = 0; // section of the last getAssign, events are mostly read in order
+
+	// sorted, the last split is the end of the events
+	static std::vector<int> getSplitEventIndexes(EventStore const& events, MidiTimeline const& timeline) {
+		std::vector<int> splits;
 		std::array<int, MidiState::CHANNEL_COUNT> sectionsNotes{};
+		std::vector<int> const& programChanges = timeline.getProgramChangeIndexes();
+		auto nextProgramChange = programChanges.begin();
 
 		for (int i = 0; i < events.size(); i++) {
-			const MidiEvent& event = events[i];
-			MidiChannelState& channelState = state.getChannel(event.chan);
-			int& sectionNotes = sectionsNotes[event.chan];
-
-			int oldProgram = channelState.program;
-			bool oldDrums = channelState.useDrums;
-
-			state.processEvent(event);
+			int& sectionNotes = sectionsNotes[events.getChan(i)];
 
-			bool programUpdated = (oldProgram != channelState.program || oldDrums != channelState.useDrums);
+			bool programUpdated = (nextProgramChange != programChanges.end() && *nextProgramChange == i);
+			if (programUpdated) {
+				++nextProgramChange;
+			}
 			if (programUpdated && sectionNotes > 0) {
-				splits.insert(i);
+				splits.push_back(i);
 				sectionsNotes.fill(0);
 			}
 
-			if (event.event == MIDI_EVENT_NOTE_ON) {
+			if (events.getType(i) == MIDI_EVENT_NOTE_ON) {
 				sectionNotes++;
 			}
 		}
 
-		splits.insert(int(events.size()));
+		splits.push_back(int(events.size()));
 
 		std::cout << "Created " << splits.size() << " split points" << std::endl;
 		return splits;
 	}
 
-	void fillChannelAssignData(std::vector<MidiEvent> const& events, std::unordered_set<int> const& splitPoints, FileSettingsJson const& settings) {
-		MidiState state;
-		auto assigner = std::make_unique<ChannelAssigner>(base, settings);
+	static std::vector<Section> getSections(EventStore const& events, MidiTimeline const& timeline, std::vector<int> const& splitPoints) {
+		MidiTimeline::Cursor cursor(timeline);
+		std::vector<Section> sections(1);
+		auto nextSplit = splitPoints.begin();
 
 		for (int i = 0; i < events.size(); i++) {
-			const MidiEvent& event = events[i];
-			state.processEvent(event);
+			cursor.moveTo(i);
 
-			if (event.event == MIDI_EVENT_NOTE_ON) {
-				assigner->addNote(event, state);
+			if (events.getType(i) == MIDI_EVENT_NOTE_ON) {
+				sections.back().midiData[events.getChan(i)].addNote(events[i], cursor);
 			}
 
-			if (splitPoints.contains(i + 1)) {
-				channelAssignData.push_back(assigner->generateAssignData(i + 1, state));
+			if (nextSplit != splitPoints.end() && *nextSplit == i + 1) {
+				++nextSplit;
+				sections.back().programs = cursor.getPrograms();
+				sections.emplace_back().eventIndex = i + 1;
 			}
 		}
+
+		sections.pop_back();
+		return sections;
+	}
+
+	// speculative search - every section is searched in parallel from the start it is assumed to have, empty data at first
+	// reconciliation - sections whose start differs from the clean result of the previous section are searched again in parallel, until no start changes
+	// the first section always has its real start, so every pass fixes at least one more section and the results are the same as searched one by one
+	template<class Stats> void fillChannelAssignDataParallel(EventStore const& events, MidiTimeline const& timeline, std::vector<int> const& splitPoints,
+		FileSettingsJson const& settings, int threadCount, Stats& stats) {
+
+		std::vector<Section> sections = getSections(events, timeline, splitPoints);
+		std::vector<std::unique_ptr<ChannelAssigner<Stats>>> assigners;
+		for (size_t i = 0; i < max(size_t(1), min(size_t(threadCount), sections.size())); i++) {
+			assigners.push_back(std::make_unique<ChannelAssigner<Stats>>(base, settings, assignCache));
+		}
+
+		std::vector<AssignData> starts(sections.size());
+		std::vector<AssignData> results(sections.size());
+		std::vector<size_t> pending(sections.size());
+		std::iota(pending.begin(), pending.end(), size_t(0));
+
+		int pass = 0;
+		size_t searchCount = 0;
+		while (!pending.empty()) {
+			std::vector<std::exception_ptr> errors(pending.size());
+			std::atomic<size_t> nextPending = 0;
+			auto worker = [&sections, &starts, &results, &pending, &errors, &nextPending, pass](ChannelAssigner<Stats>& assigner) {
+				for (size_t j = nextPending++; j < pending.size(); j = nextPending++) {
+					try {
+						Section const& section = sections[pending[j]];
+						results[pending[j]] = assigner.generateAssignData(section.eventIndex, pass, section.midiData, section.programs, starts[pending[j]]);
+					}
+					catch (...) {
+						errors[j] = std::current_exception();
+					}
+				}
+			};
+
+			{
+				std::vector<std::jthread> workers;
+				for (size_t i = 1; i < min(assigners.size(), pending.size()); i++) {
+					workers.emplace_back(worker, std::ref(*assigners[i]));
+				}
+				worker(*assigners[0]);
+			}
+
+			for (auto const& error : errors) {
+				if (error) {
+					std::rethrow_exception(error);
+				}
+			}
+
+			searchCount += pending.size();
+			pending.clear();
+			for (size_t i = 1; i < sections.size(); i++) {
+				AssignData start = IndexedAssignData(results[i - 1], sections[i - 1].eventIndex, sections[i - 1].programs).getCleanData(sections[i].programs);
+				if (start != starts[i]) {
+					starts[i] = start;
+					pending.push_back(i);
+				}
+			}
+			pass++;
+		}
+
+		std::cout << "Searched " << searchCount << " times " << sections.size() << " sections in " << pass << " passes" << std::endl;
+
+		for (auto const& sectionAssigner : assigners) {
+			stats.append(sectionAssigner->getStats());
+		}
+
+		for (size_t i = 0; i < sections.size(); i++) {
+			channelAssignData.emplace_back(results[i], sections[i].eventIndex, sections[i].programs);
+		}
 	}
 
-	const AssignData& getAssign(int eventIndex) const {
-		for (int i = 1; i < channelAssignData.size(); i++) {
-			if (channelAssignData[i].eventIndex > eventIndex) {
-				return channelAssignData[size_t(i) - 1].data;
+	template<class Stats> void fillChannelAssignData(EventStore const& events, MidiTimeline const& timeline, std::vector<int> const& splitPoints,
+		FileSettingsJson const& settings, Stats& stats) {
+
+		int threadCount = settings.assignThreads > 0 ? settings.assignThreads : max(1, int(std::thread::hardware_concurrency()));
+		if (threadCount > 1) {
+			fillChannelAssignDataParallel(events, timeline, splitPoints, settings, threadCount, stats);
+			return;
+		}
+
+		MidiTimeline::Cursor cursor(timeline);
+		auto assigner = std::make_unique<ChannelAssigner<Stats>>(base, settings, assignCache);
+		auto nextSplit = splitPoints.begin();
+
+		for (int i = 0; i < events.size(); i++) {
+			cursor.moveTo(i);
+
+			if (events.getType(i) == MIDI_EVENT_NOTE_ON) {
+				assigner->addNote(events[i], cursor);
+			}
+
+			if (nextSplit != splitPoints.end() && *nextSplit == i + 1) {
+				++nextSplit;
+				channelAssignData.push_back(assigner->generateAssignData(i + 1, cursor.getPrograms()));
 			}
 		}
-		return channelAssignData.back().data;
+
+		stats.append(assigner->getStats());
+	}
+
+	// the last section starting at or before eventIndex, the first section also covers earlier events
+	// the next few sections are walked, farther jumps in either direction use binary search
+	const AssignData& getAssign(int eventIndex) {
+		for (int step = 0; step < MAX_ASSIGN_STEPS && assignPosition + 1 < channelAssignData.size() && channelAssignData[assignPosition + 1].eventIndex <= eventIndex; step++) {
+			assignPosition++;
+		}
+
+		bool isBefore = assignPosition > 0 && channelAssignData[assignPosition].eventIndex > eventIndex;
+		bool isFarAfter = assignPosition + 1 < channelAssignData.size() && channelAssignData[assignPosition + 1].eventIndex <= eventIndex;
+		if (isBefore || isFarAfter) {
+			auto first = channelAssignData.begin() + (isBefore ? 1 : assignPosition + 2);
+			auto last = isBefore ? channelAssignData.begin() + assignPosition : channelAssignData.end();
+			auto next = std::upper_bound(first, last, eventIndex, [](int index, IndexedAssignData const& section) { return index < section.eventIndex; });
+			assignPosition = size_t(next - channelAssignData.begin()) - 1;
+		}
+		return channelAssignData[assignPosition].data;
 	}
 
 	static PlayScore calculatePlayScore(NesState const& nesState, NoteTriggerData const& checkedTrigger, MidiEvent const& event) {
@@ -82,7 +207,7 @@ private:
 
 		// don't interrupt current note with higher priorityOrder sound (e.g. crash with hi-hat)
 		if (const std::optional<PlayingNesNote>& note = nesState.getNote(checkedTrigger.nesChannel);
-			note && event.seconds < note->canInterruptSeconds && int(checkedTrigger.preset.order) > int(note->triggerData.preset.order)) {
+			note && event.seconds < note->canInterruptSeconds && int(checkedTrigger.preset->order) > int(note->triggerData.preset->order)) {
 
 			score.set(INTERRUPTS, -1);
 		}
@@ -90,7 +215,7 @@ private:
 		score.set(PLAYING, 2);
 		score.set(PLAYABLE_RANGE, Note::isInPlayableRange(checkedTrigger.nesChannel, event.key) ? 1 : 0);
 		score.set(NOTE_TIME, 0);
-		score.set(PRIORITY, -int(checkedTrigger.preset.order));
+		score.set(PRIORITY, -int(checkedTrigger.preset->order));
 		score.set(NOTE_END_TIME, min(MIN_NOTE_SECONDS, event.noteEndSeconds - event.seconds));
 		score.set(TONE_OVERLAP, -nesState.countPulseChannelsWithSameKeyAndLength(checkedTrigger.nesChannel, event, MIN_NOTE_SECONDS));
 		score.set(NOTE_HEIGHT, checkedTrigger.lowerKeysFirst ? -event.key : event.key);
@@ -115,7 +240,7 @@ private:
 		score.set(PLAYING, note->playing ? 2 : 1);
 		score.set(PLAYABLE_RANGE, Note::isInPlayableRange(triggerData.nesChannel, note->event.key) ? 1 : 0);
 		score.set(NOTE_TIME, -max(0, nesState.seconds - note->event.seconds - MIN_NOTE_SECONDS));
-		score.set(PRIORITY, -int(triggerData.preset.order));
+		score.set(PRIORITY, -int(triggerData.preset->order));
 		score.set(NOTE_END_TIME, min(MIN_NOTE_SECONDS, note->event.noteEndSeconds - nesState.seconds));
 		score.set(TONE_OVERLAP, -nesState.countPulseChannelsWithSameKeyAndLength(nesChannel, note->event, MIN_NOTE_SECONDS));
 		score.set(NOTE_HEIGHT, triggerData.lowerKeysFirst ? -note->event.key : note->event.key);
@@ -146,30 +271,40 @@ private:
 	}
 
 public:
-	void preprocess(std::vector<MidiEvent> const& events, FamiTrackerFile& file, FileSettingsJson const& settings) {
-		base.fillBase(file);
-		fillChannelAssignData(events, getSplitEventIndexes(events), settings);
+	InstrumentSelector(InstrumentBase const& base, AssignCache& assignCache) : base(base), assignCache(assignCache) {}
+
+	// stats of the search are collected only when given
+	void preprocess(EventStore const& events, MidiTimeline const& timeline, FileSettingsJson const& settings, SearchStats* stats = nullptr) {
+		std::vector<int> splitPoints = getSplitEventIndexes(events, timeline);
+		assignPosition = 0;
+		if (stats) {
+			fillChannelAssignData(events, timeline, splitPoints, settings, *stats);
+		}
+		else {
+			NoSearchStats noStats;
+			fillChannelAssignData(events, timeline, splitPoints, settings, noStats);
+		}
 	}
 
-	std::vector<NoteTriggerData> getNoteTriggers(MidiEvent const& event, int eventIndex, MidiChannelState const& midiState, NesState const& nesState, FileSettingsJson const& settings) const {
+	std::vector<NoteTriggerData> getNoteTriggers(MidiEvent const& event, int eventIndex, MidiChannelControllers const& midiState, NesState const& nesState, FileSettingsJson const& settings) {
 		std::vector<NoteTriggerData> result;
 
 		// drums can have multiple triggers (i.e. noise and dpcm for the same note)
 		// for normal instruments only one trigger is selected
 		if (midiState.useDrums) {
-			std::optional<Preset> preset = base.getDrumPreset(midiState.program, event.key);
+			Preset const* preset = base.getDrumPreset(midiState.program, event.key);
 			if (preset) {
 				std::vector<NesChannel> nesChannels = preset->getValidNesChannels();
 				for (auto const& nesChannel : nesChannels) {
-					addTriggerIfPossible(result, { NoteTriggerData(nesChannel, preset->duty, preset.value(), settings.lowerKeysFirst[event.chan])}, event, nesState);
+					addTriggerIfPossible(result, { NoteTriggerData(nesChannel, preset->duty, *preset, settings.lowerKeysFirst[event.chan])}, event, nesState);
 				}
 			}
 		}
 		else {
 			const AssignChannelData& nesData = getAssign(eventIndex).getNesData(event.chan);
-			std::optional<Preset> preset = base.getGmPreset(midiState.program);
+			Preset const* preset = base.getGmPreset(midiState.program);
 			if (preset) {
-				addTriggerIfPossible(result, nesData.getTriggers(preset.value(), settings.lowerKeysFirst[event.chan]), event, nesState);
+				addTriggerIfPossible(result, nesData.getTriggers(*preset, settings.lowerKeysFirst[event.chan]), event, nesState);
 			}
 		}
 
@@ -0,0 +1,107 @@
+#pragma once
+#include "commons.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// read-only memory mapping of a whole file, the view is valid for the lifetime of the object
+class MappedFile {
+private:
+	const uint8_t* bytes = nullptr;
+	size_t length = 0;
+
+#ifdef _WIN32
+	HANDLE fileHandle = INVALID_HANDLE_VALUE;
+	HANDLE mappingHandle = nullptr;
+#else
+	int fileDescriptor = -1;
+#endif
+
+	void close() {
+#ifdef _WIN32
+		if (bytes) {
+			UnmapViewOfFile(bytes);
+		}
+		if (mappingHandle) {
+			CloseHandle(mappingHandle);
+		}
+		if (fileHandle != INVALID_HANDLE_VALUE) {
+			CloseHandle(fileHandle);
+		}
+		fileHandle = INVALID_HANDLE_VALUE;
+		mappingHandle = nullptr;
+#else
+		if (bytes) {
+			munmap(const_cast<uint8_t*>(bytes), length);
+		}
+		if (fileDescriptor >= 0) {
+			::close(fileDescriptor);
+		}
+		fileDescriptor = -1;
+#endif
+		bytes = nullptr;
+		length = 0;
+	}
+
+public:
+	explicit MappedFile(std::filesystem::path const& path) {
+#ifdef _WIN32
+		fileHandle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("cannot open " + path.string());
+		}
+		LARGE_INTEGER fileSize{};
+		GetFileSizeEx(fileHandle, &fileSize);
+		length = size_t(fileSize.QuadPart);
+		if (length == 0) {
+			return;
+		}
+		mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle) {
+			bytes = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+		}
+#else
+		fileDescriptor = open(path.c_str(), O_RDONLY);
+		if (fileDescriptor < 0) {
+			throw std::runtime_error("cannot open " + path.string());
+		}
+		struct stat fileStat {};
+		fstat(fileDescriptor, &fileStat);
+		length = size_t(fileStat.st_size);
+		if (length == 0) {
+			return;
+		}
+		void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (view != MAP_FAILED) {
+			bytes = static_cast<const uint8_t*>(view);
+		}
+#endif
+		if (!bytes) {
+			close();
+			throw std::runtime_error("cannot map " + path.string());
+		}
+	}
+
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator = (MappedFile const&) = delete;
+
+	~MappedFile() {
+		close();
+	}
+
+	const uint8_t* data() const {
+		return bytes;
+	}
+
+	size_t size() const {
+		return length;
+	}
+};
@@ -2,6 +2,7 @@
 #include "commons.h"
 #include "Pattern.h"
 #include "MidiState.h"
+#include "MidiTimeline.h"
 
 class MidiChannelNotesData {
 private:
@@ -39,8 +40,8 @@ public:
 		}
 	}
 
-	void addNote(MidiEvent const& event, MidiState const& currentState) {
-		const MidiChannelState& channelState = currentState.getChannel(event.chan);
+	void addNote(MidiEvent const& event, MidiTimeline::Cursor& timeline) {
+		const MidiChannelControllers& channelState = timeline.getChannel(event.chan);
 		// drums are processed in InstrumentSelector::getNoteTriggers
 		if (channelState.useDrums) {
 			return;
@@ -56,16 +57,15 @@ public:
 		// added small amount to fix i.e. the strings in DOOM - E1M2
 		volumeSum += channelState.getNoteVolume(event.velocity) + 0.01;
 
-		auto noteCount = int(channelState.notes.size());
+		int noteCount = timeline.getSoundingNotes(event.chan);
 		noteCountAtNotesOn[noteCount]++;
 
 		for (int chan2 = 0; chan2 < MidiState::CHANNEL_COUNT; chan2++) {
-			const MidiChannelState& channelState2 = currentState.getChannel(chan2);
-			if (event.chan == chan2 || channelState2.useDrums) {
+			if (int(event.chan) == chan2 || timeline.getChannel(chan2).useDrums) {
 				continue;
 			}
 
-			interruptingNotes[chan2] += int(channelState2.notes.size());
+			interruptingNotes[chan2] += timeline.getSoundingNotes(chan2);
 		}
 	}
 
@@ -1,18 +1,9 @@
 #pragma once
 #include "commons.h"
 
-class MidiChannelState {
+// everything about a MIDI channel except the sounding notes
+class MidiChannelControllers {
 public:
-
-    class Note {
-    public:
-        int velocity;
-        double seconds;
-
-        Note(int velocity, double seconds) : velocity(velocity), seconds(seconds) {}
-    };
-
-    std::unordered_map<int, Note> notes{}; // key is key ;)
     int program = 0;
     double volume = 1;
     int bank = 0;
@@ -32,6 +23,22 @@ public:
         return key + pitch * pitchRange + coarseTune + fineTune;
     }
 
+    bool operator == (const MidiChannelControllers& other) const = default;
+};
+
+class MidiChannelState : public MidiChannelControllers {
+public:
+
+    class Note {
+    public:
+        int velocity;
+        double seconds;
+
+        Note(int velocity, double seconds) : velocity(velocity), seconds(seconds) {}
+    };
+
+    std::unordered_map<int, Note> notes{}; // key is key ;)
+
     void stopAllNotes() {
         notes.clear();
     }
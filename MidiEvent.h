@@ -1,16 +1,56 @@
 #pragma once
 #include "commons.h"
 
-constexpr DWORD MIDI_EVENT_NOTE_ON   = 129;
-constexpr DWORD MIDI_EVENT_NOTE_OFF  = 130;
-constexpr DWORD MIDI_EVENT_NOTE_STOP = 131;
+// event types, values are the same as in BASSMIDI
+constexpr uint32_t MIDI_EVENT_END         = 0;
+constexpr uint32_t MIDI_EVENT_NOTE        = 1;
+constexpr uint32_t MIDI_EVENT_PROGRAM     = 2;
+constexpr uint32_t MIDI_EVENT_CHANPRES    = 3;
+constexpr uint32_t MIDI_EVENT_PITCH       = 4;
+constexpr uint32_t MIDI_EVENT_PITCHRANGE  = 5;
+constexpr uint32_t MIDI_EVENT_DRUMS       = 6;
+constexpr uint32_t MIDI_EVENT_FINETUNE    = 7;
+constexpr uint32_t MIDI_EVENT_COARSETUNE  = 8;
+constexpr uint32_t MIDI_EVENT_BANK        = 10;
+constexpr uint32_t MIDI_EVENT_MODULATION  = 11;
+constexpr uint32_t MIDI_EVENT_VOLUME      = 12;
+constexpr uint32_t MIDI_EVENT_PAN         = 13;
+constexpr uint32_t MIDI_EVENT_EXPRESSION  = 14;
+constexpr uint32_t MIDI_EVENT_SUSTAIN     = 15;
+constexpr uint32_t MIDI_EVENT_SOUNDOFF    = 16;
+constexpr uint32_t MIDI_EVENT_RESET       = 17;
+constexpr uint32_t MIDI_EVENT_NOTESOFF    = 18;
+constexpr uint32_t MIDI_EVENT_PORTAMENTO  = 19;
+constexpr uint32_t MIDI_EVENT_PORTATIME   = 20;
+constexpr uint32_t MIDI_EVENT_REVERB      = 23;
+constexpr uint32_t MIDI_EVENT_CHORUS      = 24;
+constexpr uint32_t MIDI_EVENT_SOFT        = 60;
+constexpr uint32_t MIDI_EVENT_SYSTEM      = 61;
+constexpr uint32_t MIDI_EVENT_TEMPO       = 62;
+constexpr uint32_t MIDI_EVENT_CONTROL     = 64;
+constexpr uint32_t MIDI_EVENT_BANK_LSB    = 70;
+constexpr uint32_t MIDI_EVENT_KEYPRES     = 71;
+constexpr uint32_t MIDI_EVENT_SOSTENUTO   = 76;
+constexpr uint32_t MIDI_EVENT_SYSTEMEX    = 0x10002;
+constexpr uint32_t MIDI_EVENT_END_TRACK   = 0x10003;
+
+// params of MIDI_EVENT_SYSTEM and MIDI_EVENT_SYSTEMEX
+constexpr uint32_t MIDI_SYSTEM_DEFAULT = 0;
+constexpr uint32_t MIDI_SYSTEM_GM1     = 1;
+constexpr uint32_t MIDI_SYSTEM_GM2     = 2;
+constexpr uint32_t MIDI_SYSTEM_XG      = 3;
+constexpr uint32_t MIDI_SYSTEM_GS      = 4;
+
+constexpr uint32_t MIDI_EVENT_NOTE_ON   = 129;
+constexpr uint32_t MIDI_EVENT_NOTE_OFF  = 130;
+constexpr uint32_t MIDI_EVENT_NOTE_STOP = 131;
 
 // it splits MIDI_EVENT_NOTE to one of the 3 above, uses time in seconds and contains info about note length
 class MidiEvent {
 public:
-	DWORD event;
-	DWORD param;
-	DWORD chan;
+	uint32_t event;
+	uint32_t param;
+	uint32_t chan;
 	double seconds;
 
 	// only for MIDI_EVENT_NOTE_ON
@@ -22,11 +62,12 @@ public:
 	// only for MIDI_EVENT_NOTE_ON
 	int velocity = -1;
 
-	MidiEvent(HSTREAM handle, BASS_MIDI_EVENT& bassEvent) : event(bassEvent.event), param(bassEvent.param), chan(bassEvent.chan),
-		seconds(BASS_ChannelBytes2Seconds(handle, bassEvent.pos)), noteEndSeconds(seconds) {
+	// for MIDI_EVENT_NOTE the param is key in low byte and velocity in high byte
+	MidiEvent(uint32_t event_, uint32_t param_, uint32_t chan_, double seconds_) : event(event_), param(param_), chan(chan_),
+		seconds(seconds_), noteEndSeconds(seconds_) {
 		if (event == MIDI_EVENT_NOTE) {
-			key = LOBYTE(param);
-			velocity = HIBYTE(param);
+			key = int(param & 0xFF);
+			velocity = int((param >> 8) & 0xFF);
 			if (velocity == 0) {
 				event = MIDI_EVENT_NOTE_OFF;
 			}
@@ -39,6 +80,10 @@ public:
 		}
 	}
 
+	// already split event, i.e. rebuilt from EventStore
+	MidiEvent(uint32_t event_, uint32_t param_, uint32_t chan_, double seconds_, double noteEndSeconds_, int key_, int velocity_) : event(event_), param(param_), chan(chan_),
+		seconds(seconds_), noteEndSeconds(noteEndSeconds_), key(key_), velocity(velocity_) {}
+
 	// only for MIDI_EVENT_NOTE_ON
 	void linkNoteEnd(MidiEvent const& noteEnd) {
 		noteEndSeconds = noteEnd.seconds;
@@ -2,59 +2,183 @@
 #include "commons.h"
 #include "MidiEvent.h"
 #include "MidiState.h"
+#include "MidiFileReader.h"
+#include "TempoMap.h"
+#include "EventStore.h"
+#include "NoteLinker.h"
+#include "EventCache.h"
 
 class MidiEventParser {
 private:
-    static std::vector<BASS_MIDI_EVENT> getBassEvents(HSTREAM handle) {
-        DWORD eventCount = BASS_MIDI_StreamGetEvents(handle, -1, 0, nullptr);
-        std::vector<BASS_MIDI_EVENT> events(eventCount);
-        BASS_MIDI_StreamGetEvents(handle, -1, 0, events.data());
-        return events;
-    }
+    EventStore events;
+    TempoMap tempoMap;
+
+    static constexpr size_t MIN_WORKER_BYTES = 64 * 1024; // decoded in about 150 us, starting a worker takes about 20 us
+
+    // each track chunk is decoded on its own worker to its own buffer, small files are decoded on the calling thread
+    static std::vector<std::vector<MidiFileEvent>> decodeTracks(MidiFileReader const& reader, std::vector<uint64_t>& trackEndTicks) {
+        int trackCount = reader.getTrackCount();
+        std::vector<std::vector<MidiFileEvent>> trackEvents(trackCount);
+        std::vector<std::exception_ptr> errors(trackCount);
+        trackEndTicks.assign(trackCount, 0);
 
-    static std::vector<BASS_MIDI_MARK> getBassMarks(HSTREAM handle) {
-        DWORD markCount = BASS_MIDI_StreamGetMarks(handle, -1, BASS_MIDI_MARK_MARKER, nullptr);
-        std::vector<BASS_MIDI_MARK> marks(markCount);
-        BASS_MIDI_StreamGetMarks(handle, -1, BASS_MIDI_MARK_MARKER, marks.data());
-        return marks;
+        std::atomic<int> nextTrack = 0;
+        auto worker = [&reader, &trackEvents, &errors, &trackEndTicks, &nextTrack, trackCount]() {
+            for (int track = nextTrack++; track < trackCount; track = nextTrack++) {
+                try {
+                    trackEvents[track].reserve(reader.getEventCountEstimate(track));
+                    trackEndTicks[track] = reader.decodeTrack(track, trackEvents[track]);
+                }
+                catch (...) {
+                    errors[track] = std::current_exception();
+                }
+            }
+        };
+
+        {
+            int byteWorkers = int(min(reader.getFile().size() / MIN_WORKER_BYTES, size_t(INT_MAX)));
+            int workerCount = max(1, min(min(trackCount, byteWorkers), int(std::thread::hardware_concurrency())));
+            std::vector<std::jthread> workers;
+            for (int i = 1; i < workerCount; i++) {
+                workers.emplace_back(worker);
+            }
+            worker();
+        }
+
+        for (auto const& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+        return trackEvents;
     }
 
-public:
-	static std::vector<MidiEvent> getEvents(HSTREAM handle) {
-        std::vector<BASS_MIDI_EVENT> bassEvents = getBassEvents(handle);
+    // stable k-way merge by tick, simultaneous events keep the track order
+    static std::vector<MidiFileEvent> mergeTracks(std::vector<std::vector<MidiFileEvent>> const& trackEvents) {
+        using HeapEntry = std::pair<uint64_t, int>; // tick, track
 
-        auto noteOnIndexesPtr = std::make_unique<std::array<std::array<std::vector<int>, MidiState::KEY_COUNT>, MidiState::CHANNEL_COUNT>>();
-        auto& noteOnIndexes = *noteOnIndexesPtr.get();
+        std::vector<MidiFileEvent> results;
+        results.reserve(std::transform_reduce(trackEvents.begin(), trackEvents.end(), size_t(1), std::plus<>(), [](auto const& events) { return events.size(); }));
 
-        std::vector<MidiEvent> results;
-        for (auto& bassEvent : bassEvents) {
-            if (bassEvent.chan >= MidiState::CHANNEL_COUNT) {
-                continue;
+        std::vector<size_t> positions(trackEvents.size(), 0);
+        std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<>> heap;
+        for (size_t track = 0; track < trackEvents.size(); track++) {
+            if (!trackEvents[track].empty()) {
+                heap.emplace(trackEvents[track][0].tick, int(track));
             }
+        }
+
+        while (!heap.empty()) {
+            int track = heap.top().second;
+            heap.pop();
 
-            MidiEvent event(handle, bassEvent);
+            // take the whole run of this track that does not pass the next track in the heap
+            std::vector<MidiFileEvent> const& events = trackEvents[track];
+            size_t& position = positions[track];
+            HeapEntry limit = heap.empty() ? HeapEntry(UINT64_MAX, INT_MAX) : heap.top();
+            do {
+                results.push_back(events[position++]);
+            } while (position < events.size() && HeapEntry(events[position].tick, track) < limit);
 
-            if (event.event == MIDI_EVENT_NOTE_ON) {
-                noteOnIndexes[event.chan][event.key].push_back(int(results.size()));
+            if (position < events.size()) {
+                heap.emplace(events[position].tick, track);
             }
-            else if (event.event == MIDI_EVENT_NOTE_OFF || event.event == MIDI_EVENT_NOTE_STOP) {
-                for (int& index : noteOnIndexes[event.chan][event.key]) {
-                    results[index].linkNoteEnd(event);
+        }
+
+        return results;
+    }
+
+    // format 0 and 1 tracks play together, format 2 tracks are independent sequences played one after another
+    // every sequence ends with MIDI_EVENT_END, so format 2 tracks can be split back to songs by EventStore::splitSongs
+    // every later sequence starts with the default tempo, a tempo event of the sequence at its first tick replaces it
+    static std::vector<MidiFileEvent> getFileEvents(MidiFileReader const& reader) {
+        std::vector<uint64_t> trackEndTicks;
+        std::vector<std::vector<MidiFileEvent>> trackEvents = decodeTracks(reader, trackEndTicks);
+
+        uint64_t endTick = 0;
+        for (size_t track = 0; track < trackEvents.size(); track++) {
+            if (reader.getFormat() == 2) {
+                for (auto& fileEvent : trackEvents[track]) {
+                    fileEvent.tick += endTick;
                 }
-                noteOnIndexes[event.chan][event.key].clear();
-            }
-            else if (event.event == MIDI_EVENT_NOTESOFF || event.event == MIDI_EVENT_SOUNDOFF) {
-                for (int key = 0; key < MidiState::KEY_COUNT; key++) {
-                    for (int& index : noteOnIndexes[event.chan][key]) {
-                        results[index].linkNoteEnd(event);
-                    }
-                    noteOnIndexes[event.chan][key].clear();
+                if (track > 0) {
+                    trackEvents[track].emplace(trackEvents[track].begin(), endTick, MIDI_EVENT_TEMPO, TempoMap::DEFAULT_MICROS_PER_QUARTER, 0);
                 }
+                endTick += trackEndTicks[track];
+                trackEvents[track].emplace_back(endTick, MIDI_EVENT_END, 0, 0);
             }
+            else {
+                endTick = max(endTick, trackEndTicks[track]);
+            }
+        }
 
-            results.push_back(event);
+        std::vector<MidiFileEvent> fileEvents = mergeTracks(trackEvents);
+        if (reader.getFormat() != 2) {
+            fileEvents.emplace_back(endTick, MIDI_EVENT_END, 0, 0);
         }
+        return fileEvents;
+    }
 
+    static TempoMap createTempoMap(int division, std::vector<MidiFileEvent> const& fileEvents) {
+        TempoMap result(division);
+        for (auto& fileEvent : fileEvents) {
+            if (fileEvent.event == MIDI_EVENT_TEMPO) {
+                result.addTempo(fileEvent.tick, fileEvent.param);
+            }
+        }
+        return result;
+    }
+
+    static EventStore createEvents(std::vector<MidiFileEvent> const& fileEvents, TempoMap const& tempoMap) {
+        TempoMap::Cursor tempoCursor(tempoMap);
+
+        EventStore results;
+        results.reserve(fileEvents.size());
+        for (auto& fileEvent : fileEvents) {
+            if (fileEvent.chan >= MidiState::CHANNEL_COUNT) {
+                continue;
+            }
+            results.add(MidiEvent(fileEvent.event, fileEvent.param, fileEvent.chan, tempoCursor.getSeconds(fileEvent.tick)));
+        }
+
+        // runs on the merged list, note ends can come from a different track than their note ons
+        std::make_unique<NoteLinker>(results.size())->link(results);
         return results;
-	}
-};
\ No newline at end of file
+    }
+
+public:
+    // bump when the produced events change, it invalidates EventCache entries
+    static constexpr uint32_t VERSION = 4;
+
+    explicit MidiEventParser(std::filesystem::path const& path, std::optional<std::filesystem::path> const& cacheDirectory = {}) {
+        MidiFileReader reader(path);
+
+        std::optional<EventCache> cache;
+        uint64_t hash = 0;
+        uint64_t size = reader.getFile().size();
+        if (cacheDirectory) {
+            cache.emplace(cacheDirectory.value(), VERSION);
+            hash = EventCache::hashBytes(reader.getFile().data(), reader.getFile().size());
+            if (cache->load(hash, size, events, tempoMap)) {
+                std::cout << "Loaded " << events.size() << " events from cache" << std::endl;
+                return;
+            }
+        }
+
+        std::vector<MidiFileEvent> fileEvents = getFileEvents(reader);
+        tempoMap = createTempoMap(reader.getDivision(), fileEvents);
+        events = createEvents(fileEvents, tempoMap);
+
+        if (cache) {
+            cache->store(hash, size, events, tempoMap);
+        }
+    }
+
+    const TempoMap& getTempoMap() const {
+        return tempoMap;
+    }
+
+    const EventStore& getEvents() const {
+        return events;
+    }
+};
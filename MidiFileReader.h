@@ -0,0 +1,383 @@
+#pragma once
+#include "commons.h"
+#include "MidiEvent.h"
+#include "MidiState.h"
+#include "MappedFile.h"
+
+// event decoded from a MTrk chunk, time is still in ticks
+class MidiFileEvent {
+public:
+	uint64_t tick;
+	uint32_t event;
+	uint32_t param;
+	uint32_t chan;
+
+	MidiFileEvent(uint64_t tick, uint32_t event, uint32_t param, uint32_t chan) : tick(tick), event(event), param(param), chan(chan) {}
+};
+
+// Standard MIDI File (format 0, 1 and 2) reader, decodes channel messages to the BASSMIDI event model used by MidiEvent
+class MidiFileReader {
+private:
+	// position of a MTrk chunk inside the mapped file
+	class TrackChunk {
+	public:
+		const uint8_t* begin;
+		const uint8_t* end;
+
+		TrackChunk(const uint8_t* begin, const uint8_t* end) : begin(begin), end(end) {}
+	};
+
+	// registered parameter numbers handled by BASSMIDI
+	static constexpr int RPN_PITCHRANGE = 0;
+	static constexpr int RPN_FINETUNE = 1;
+	static constexpr int RPN_COARSETUNE = 2;
+	static constexpr int RPN_NONE = 0x3FFF;
+
+	// state needed to translate data entry controllers to RPN events
+	class ChannelRpnState {
+	public:
+		int rpn = RPN_NONE;
+		int dataMsb = 0;
+		int dataLsb = 0;
+	};
+
+	MappedFile file;
+	int format = 0;
+	int division = 0;
+	std::vector<TrackChunk> tracks;
+
+	static uint32_t readBigEndian(const uint8_t* data, int byteCount) {
+		uint32_t value = 0;
+		for (int i = 0; i < byteCount; i++) {
+			value = (value << 8) | data[i];
+		}
+		return value;
+	}
+
+	static uint32_t readVariableLength(const uint8_t*& data, const uint8_t* end) {
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++) {
+			if (data >= end) {
+				throw std::runtime_error("unexpected end of track");
+			}
+			uint8_t byte = *data++;
+			value = (value << 7) | (byte & 0x7F);
+			if ((byte & 0x80) == 0) {
+				return value;
+			}
+		}
+		throw std::runtime_error("variable length quantity too long");
+	}
+
+	void readChunks() {
+		const uint8_t* data = file.data();
+		const uint8_t* end = data + file.size();
+
+		// RIFF wrapped MIDI (.rmi) has the SMF in the "data" chunk
+		if (file.size() >= 20 && std::equal(data, data + 4, "RIFF") && std::equal(data + 8, data + 12, "RMID")) {
+			data += 12;
+			while (data + 8 <= end && !std::equal(data, data + 4, "data")) {
+				data += 8 + ((size_t(data[4]) | size_t(data[5]) << 8 | size_t(data[6]) << 16 | size_t(data[7]) << 24) + 1) / 2 * 2;
+			}
+			data += 8;
+		}
+
+		if (data + 14 > end || !std::equal(data, data + 4, "MThd")) {
+			throw std::runtime_error("not a MIDI file");
+		}
+		uint32_t headerLength = readBigEndian(data + 4, 4);
+		format = int(readBigEndian(data + 8, 2));
+		int trackCount = int(readBigEndian(data + 10, 2));
+		division = int(int16_t(readBigEndian(data + 12, 2)));
+		if (format > 2 || division == 0) {
+			throw std::runtime_error("unsupported MIDI header");
+		}
+		data += 8 + size_t(headerLength);
+
+		// unknown chunk types are skipped, truncated last chunk is accepted
+		while (data + 8 <= end && int(tracks.size()) < trackCount) {
+			size_t length = readBigEndian(data + 4, 4);
+			const uint8_t* chunkBegin = data + 8;
+			const uint8_t* chunkEnd = length > size_t(end - chunkBegin) ? end : chunkBegin + length;
+			if (std::equal(data, data + 4, "MTrk")) {
+				tracks.emplace_back(chunkBegin, chunkEnd);
+			}
+			data = chunkEnd;
+		}
+	}
+
+	static std::optional<uint32_t> getSystemReset(const uint8_t* data, size_t length) {
+		static constexpr std::array<uint8_t, 5> GM1_ON = { 0x7E, 0x7F, 0x09, 0x01, 0xF7 };
+		static constexpr std::array<uint8_t, 5> GM2_ON = { 0x7E, 0x7F, 0x09, 0x03, 0xF7 };
+		static constexpr std::array<uint8_t, 10> GS_RESET = { 0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7F, 0x00, 0x41, 0xF7 };
+		static constexpr std::array<uint8_t, 8> XG_ON = { 0x43, 0x10, 0x4C, 0x00, 0x00, 0x7E, 0x00, 0xF7 };
+
+		auto matches = [data, length](auto const& message) {
+			return length == message.size() && std::equal(message.begin(), message.end(), data);
+		};
+
+		if (matches(GM1_ON)) {
+			return MIDI_SYSTEM_GM1;
+		}
+		if (matches(GM2_ON)) {
+			return MIDI_SYSTEM_GM2;
+		}
+		if (matches(GS_RESET)) {
+			return MIDI_SYSTEM_GS;
+		}
+		if (matches(XG_ON)) {
+			return MIDI_SYSTEM_XG;
+		}
+		return {};
+	}
+
+	// GS "use for rhythm part" (41 dev 42 12 40 1x 15 vv) and XG part mode (43 1n 4C 08 pp 07 vv), data starts after F0
+	// returns the channel and the MIDI_EVENT_DRUMS param, drum maps and drum setups only switch the channel to drums
+	static std::optional<std::pair<uint32_t, uint32_t>> getDrumPart(const uint8_t* data, size_t length) {
+		if (length == 10 && data[0] == 0x41 && data[2] == 0x42 && data[3] == 0x12 && data[4] == 0x40 && (data[5] & 0xF0) == 0x10 && data[6] == 0x15 && data[9] == 0xF7) {
+			// part 1x is channel 9 for x = 0, then channels 0-8 and 10-15
+			int part = data[5] & 0x0F;
+			uint32_t chan = part == 0 ? 9 : part <= 9 ? part - 1 : part;
+			return std::pair(chan, uint32_t(data[7] >= 1));
+		}
+		if (length == 8 && data[0] == 0x43 && (data[1] & 0xF0) == 0x10 && data[2] == 0x4C && data[3] == 0x08 && data[4] < MidiState::CHANNEL_COUNT && data[5] == 0x07 && data[7] == 0xF7) {
+			return std::pair(uint32_t(data[4]), uint32_t(data[6] >= 1));
+		}
+		return {};
+	}
+
+	static void addControlChange(std::vector<MidiFileEvent>& events, std::array<ChannelRpnState, MidiState::CHANNEL_COUNT>& rpnStates,
+		uint64_t tick, uint32_t chan, int controller, int value) {
+
+		ChannelRpnState& rpnState = rpnStates[chan];
+
+		auto addRpnEvent = [&events, &rpnState, tick, chan]() {
+			switch (rpnState.rpn) {
+			case RPN_PITCHRANGE:
+				events.emplace_back(tick, MIDI_EVENT_PITCHRANGE, uint32_t(rpnState.dataMsb), chan);
+				break;
+			case RPN_FINETUNE:
+				events.emplace_back(tick, MIDI_EVENT_FINETUNE, uint32_t((rpnState.dataMsb << 7) | rpnState.dataLsb), chan);
+				break;
+			case RPN_COARSETUNE:
+				events.emplace_back(tick, MIDI_EVENT_COARSETUNE, uint32_t(rpnState.dataMsb), chan);
+				break;
+			default:
+				break;
+			}
+		};
+
+		switch (controller) {
+		case 0:
+			events.emplace_back(tick, MIDI_EVENT_BANK, uint32_t(value), chan);
+			break;
+		case 1:
+			events.emplace_back(tick, MIDI_EVENT_MODULATION, uint32_t(value), chan);
+			break;
+		case 5:
+			events.emplace_back(tick, MIDI_EVENT_PORTATIME, uint32_t(value), chan);
+			break;
+		case 6:
+			rpnState.dataMsb = value;
+			rpnState.dataLsb = 0;
+			addRpnEvent();
+			break;
+		case 7:
+			events.emplace_back(tick, MIDI_EVENT_VOLUME, uint32_t(value), chan);
+			break;
+		case 10:
+			events.emplace_back(tick, MIDI_EVENT_PAN, uint32_t(value), chan);
+			break;
+		case 11:
+			events.emplace_back(tick, MIDI_EVENT_EXPRESSION, uint32_t(value), chan);
+			break;
+		case 32:
+			events.emplace_back(tick, MIDI_EVENT_BANK_LSB, uint32_t(value), chan);
+			break;
+		case 38:
+			rpnState.dataLsb = value;
+			if (rpnState.rpn == RPN_FINETUNE) {
+				addRpnEvent();
+			}
+			break;
+		case 64:
+			events.emplace_back(tick, MIDI_EVENT_SUSTAIN, uint32_t(value), chan);
+			break;
+		case 65:
+			events.emplace_back(tick, MIDI_EVENT_PORTAMENTO, uint32_t(value), chan);
+			break;
+		case 66:
+			events.emplace_back(tick, MIDI_EVENT_SOSTENUTO, uint32_t(value), chan);
+			break;
+		case 67:
+			events.emplace_back(tick, MIDI_EVENT_SOFT, uint32_t(value), chan);
+			break;
+		case 91:
+			events.emplace_back(tick, MIDI_EVENT_REVERB, uint32_t(value), chan);
+			break;
+		case 93:
+			events.emplace_back(tick, MIDI_EVENT_CHORUS, uint32_t(value), chan);
+			break;
+		case 98:
+		case 99:
+			// NRPN selected, data entry is ignored until the next RPN
+			rpnState.rpn = RPN_NONE;
+			break;
+		case 100:
+			rpnState.rpn = (rpnState.rpn & 0x3F80) | value;
+			break;
+		case 101:
+			rpnState.rpn = (rpnState.rpn & 0x7F) | (value << 7);
+			break;
+		case 120:
+			events.emplace_back(tick, MIDI_EVENT_SOUNDOFF, 0, chan);
+			break;
+		case 121:
+			events.emplace_back(tick, MIDI_EVENT_RESET, 0, chan);
+			break;
+		case 123:
+		case 124:
+		case 125:
+		case 126:
+		case 127:
+			events.emplace_back(tick, MIDI_EVENT_NOTESOFF, 0, chan);
+			break;
+		default:
+			events.emplace_back(tick, MIDI_EVENT_CONTROL, uint32_t(controller | (value << 8)), chan);
+			break;
+		}
+	}
+
+public:
+	explicit MidiFileReader(std::filesystem::path const& path) : file(path) {
+		readChunks();
+	}
+
+	const MappedFile& getFile() const {
+		return file;
+	}
+
+	int getFormat() const {
+		return format;
+	}
+
+	int getTrackCount() const {
+		return int(tracks.size());
+	}
+
+	// upper estimate for reserving, dense tracks use roughly 3 bytes per event
+	size_t getEventCountEstimate(int track) const {
+		return size_t(tracks[track].end - tracks[track].begin) / 3;
+	}
+
+	// positive value is ticks per quarter note, negative is SMPTE (-frames per second in high byte, ticks per frame in low byte)
+	int getDivision() const {
+		return division;
+	}
+
+	// decodes one MTrk chunk, events are in file order, the returned tick is the end of the track
+	uint64_t decodeTrack(int track, std::vector<MidiFileEvent>& events) const {
+		const uint8_t* data = tracks[track].begin;
+		const uint8_t* end = tracks[track].end;
+
+		std::array<ChannelRpnState, MidiState::CHANNEL_COUNT> rpnStates{};
+		uint64_t tick = 0;
+		uint8_t runningStatus = 0;
+
+		while (data < end) {
+			tick += readVariableLength(data, end);
+			if (data >= end) {
+				break;
+			}
+
+			uint8_t status = *data;
+			if (status & 0x80) {
+				data++;
+			}
+			else if (runningStatus) {
+				status = runningStatus;
+			}
+			else {
+				throw std::runtime_error("data byte without status");
+			}
+
+			// running status is kept after meta and sysex events, some files rely on it
+			if (status == 0xFF) {
+				if (data >= end) {
+					break;
+				}
+				uint8_t type = *data++;
+				uint32_t length = readVariableLength(data, end);
+				if (length > size_t(end - data)) {
+					break;
+				}
+				if (type == 0x51 && length >= 3) {
+					events.emplace_back(tick, MIDI_EVENT_TEMPO, readBigEndian(data, 3), 0);
+				}
+				data += length;
+				if (type == 0x2F) {
+					break;
+				}
+				continue;
+			}
+
+			if (status == 0xF0 || status == 0xF7) {
+				uint32_t length = readVariableLength(data, end);
+				if (length > size_t(end - data)) {
+					break;
+				}
+				if (std::optional<uint32_t> system = getSystemReset(data, length); status == 0xF0 && system) {
+					events.emplace_back(tick, MIDI_EVENT_SYSTEMEX, system.value(), 0);
+				}
+				else if (auto drumPart = getDrumPart(data, length); status == 0xF0 && drumPart) {
+					events.emplace_back(tick, MIDI_EVENT_DRUMS, drumPart->second, drumPart->first);
+				}
+				data += length;
+				continue;
+			}
+
+			if (status >= 0xF0) {
+				// system common/realtime messages are not allowed in files, skip the status byte only
+				continue;
+			}
+
+			runningStatus = status;
+			uint32_t chan = status & 0x0F;
+			int dataLength = ((status & 0xE0) == 0xC0) ? 1 : 2;
+			if (end - data < dataLength) {
+				break;
+			}
+			int data1 = data[0] & 0x7F;
+			int data2 = dataLength == 2 ? data[1] & 0x7F : 0;
+			data += dataLength;
+
+			switch (status & 0xF0) {
+			case 0x80:
+				events.emplace_back(tick, MIDI_EVENT_NOTE, uint32_t(data1), chan);
+				break;
+			case 0x90:
+				events.emplace_back(tick, MIDI_EVENT_NOTE, uint32_t(data1 | (data2 << 8)), chan);
+				break;
+			case 0xA0:
+				events.emplace_back(tick, MIDI_EVENT_KEYPRES, uint32_t(data1 | (data2 << 8)), chan);
+				break;
+			case 0xB0:
+				addControlChange(events, rpnStates, tick, chan, data1, data2);
+				break;
+			case 0xC0:
+				events.emplace_back(tick, MIDI_EVENT_PROGRAM, uint32_t(data1), chan);
+				break;
+			case 0xD0:
+				events.emplace_back(tick, MIDI_EVENT_CHANPRES, uint32_t(data1), chan);
+				break;
+			case 0xE0:
+				events.emplace_back(tick, MIDI_EVENT_PITCH, uint32_t(data1 | (data2 << 7)), chan);
+				break;
+			default:
+				break;
+			}
+		}
+
+		return tick;
+	}
+};
@@ -0,0 +1,136 @@
+#pragma once
+#include "commons.h"
+#include "MidiState.h"
+#include "MidiChannelState.h"
+#include "EventStore.h"
+
+// result of replaying all events through MidiState once, queried by the preprocessing and the conversion
+class MidiTimeline {
+private:
+	// controllers of a channel after processing the event at eventIndex
+	class ChannelChange {
+	public:
+		int eventIndex;
+		MidiChannelControllers controllers;
+
+		ChannelChange(int eventIndex, MidiChannelControllers const& controllers) : eventIndex(eventIndex), controllers(controllers) {}
+	};
+
+	// sounding note count of every channel after processing the note on at eventIndex
+	class NoteOnState {
+	public:
+		int eventIndex;
+		std::array<uint8_t, MidiState::CHANNEL_COUNT> soundingNotes;
+
+		NoteOnState(int eventIndex, std::array<uint8_t, MidiState::CHANNEL_COUNT> const& soundingNotes) : eventIndex(eventIndex), soundingNotes(soundingNotes) {}
+	};
+
+	std::array<std::vector<ChannelChange>, MidiState::CHANNEL_COUNT> channelChanges;
+	std::vector<NoteOnState> noteOnStates;
+	std::vector<int> programChangeIndexes; // events that changed program or drums of their own channel
+
+	void addChannelChange(MidiState const& state, int chan, int eventIndex) {
+		const MidiChannelControllers& controllers = state.getChannel(chan);
+		if (!(channelChanges[chan].back().controllers == controllers)) {
+			channelChanges[chan].emplace_back(eventIndex, controllers);
+		}
+	}
+
+public:
+	// monotonic walk over event indexes, O(1) amortized per query
+	class Cursor {
+	private:
+		const MidiTimeline& timeline;
+		int eventIndex = -1;
+		std::array<size_t, MidiState::CHANNEL_COUNT> changePositions{};
+		size_t noteOnPosition = 0;
+
+	public:
+		explicit Cursor(MidiTimeline const& timeline) : timeline(timeline) {}
+
+		// the state is the one after processing the event, -1 is the initial state
+		void moveTo(int eventIndex_) {
+			eventIndex = eventIndex_;
+		}
+
+		const MidiChannelControllers& getChannel(int chan) {
+			auto const& changes = timeline.channelChanges[chan];
+			size_t& position = changePositions[chan];
+			while (position + 1 < changes.size() && changes[position + 1].eventIndex <= eventIndex) {
+				position++;
+			}
+			return changes[position].controllers;
+		}
+
+		// only when the cursor is at MIDI_EVENT_NOTE_ON
+		int getSoundingNotes(int chan) {
+			auto const& states = timeline.noteOnStates;
+			while (states[noteOnPosition].eventIndex < eventIndex) {
+				noteOnPosition++;
+			}
+			return states[noteOnPosition].soundingNotes[chan];
+		}
+
+		std::array<int, MidiState::CHANNEL_COUNT> getPrograms() {
+			std::array<int, MidiState::CHANNEL_COUNT> programs{};
+			for (size_t chan = 0; chan < programs.size(); chan++) {
+				programs[chan] = getChannel(chan).program;
+			}
+			return programs;
+		}
+	};
+
+	MidiTimeline() {
+		MidiState initialState;
+		for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+			channelChanges[chan].emplace_back(-1, initialState.getChannel(chan));
+		}
+	}
+
+	explicit MidiTimeline(EventStore const& events) : MidiTimeline() {
+		MidiState state;
+
+		for (int i = 0; i < events.size(); i++) {
+			const MidiEvent event = events[i];
+			const MidiChannelState& channelState = state.getChannel(event.chan);
+
+			int oldProgram = channelState.program;
+			bool oldDrums = channelState.useDrums;
+
+			state.processEvent(event);
+
+			if (oldProgram != channelState.program || oldDrums != channelState.useDrums) {
+				programChangeIndexes.push_back(i);
+			}
+
+			switch (event.event) {
+			case MIDI_EVENT_NOTE_ON: {
+				std::array<uint8_t, MidiState::CHANNEL_COUNT> soundingNotes{};
+				for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+					soundingNotes[chan] = uint8_t(state.getChannel(chan).notes.size());
+				}
+				noteOnStates.emplace_back(i, soundingNotes);
+				break;
+			}
+			case MIDI_EVENT_NOTE_OFF:
+			case MIDI_EVENT_NOTE_STOP:
+			case MIDI_EVENT_NOTESOFF:
+			case MIDI_EVENT_SOUNDOFF:
+				break;
+			case MIDI_EVENT_SYSTEM:
+			case MIDI_EVENT_SYSTEMEX:
+				for (int chan = 0; chan < MidiState::CHANNEL_COUNT; chan++) {
+					addChannelChange(state, chan, i);
+				}
+				break;
+			default:
+				addChannelChange(state, event.chan, i);
+				break;
+			}
+		}
+	}
+
+	std::vector<int> const& getProgramChangeIndexes() const {
+		return programChangeIndexes;
+	}
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include "commons.h"
+#include "MidiState.h"
+#include "EventStore.h"
+
+// links every MIDI_EVENT_NOTE_ON to the event that ends it
+// sounding note ons are kept in intrusive per (chan, key) stacks inside one preallocated pool, so linking does not allocate
+class NoteLinker {
+private:
+	static constexpr int NONE = -1;
+	static constexpr int KEY_WORDS = MidiState::KEY_COUNT / 64;
+
+	std::vector<int> nextNoteOn; // pool indexed by event index, next older note on with the same chan and key
+	std::array<std::array<int, MidiState::KEY_COUNT>, MidiState::CHANNEL_COUNT> lastNoteOn;
+	std::array<std::array<uint64_t, KEY_WORDS>, MidiState::CHANNEL_COUNT> activeKeys{};
+
+	void noteOn(int chan, int key, int index) {
+		nextNoteOn[index] = lastNoteOn[chan][key];
+		lastNoteOn[chan][key] = index;
+		activeKeys[chan][key / 64] |= uint64_t(1) << (key % 64);
+	}
+
+	void noteEnd(EventStore& events, int chan, int key, int index) {
+		for (int noteOn = lastNoteOn[chan][key]; noteOn != NONE; noteOn = nextNoteOn[noteOn]) {
+			events.linkNoteEnd(noteOn, index);
+		}
+		lastNoteOn[chan][key] = NONE;
+		activeKeys[chan][key / 64] &= ~(uint64_t(1) << (key % 64));
+	}
+
+	// visits only the keys that are sounding
+	void allNotesEnd(EventStore& events, int chan, int index) {
+		for (int word = 0; word < KEY_WORDS; word++) {
+			while (activeKeys[chan][word] != 0) {
+				int key = word * 64 + std::countr_zero(activeKeys[chan][word]);
+				noteEnd(events, chan, key, index);
+			}
+		}
+	}
+
+public:
+	explicit NoteLinker(int eventCount) : nextNoteOn(eventCount, NONE) {
+		for (auto& channelNoteOns : lastNoteOn) {
+			channelNoteOns.fill(NONE);
+		}
+	}
+
+	void link(EventStore& events) {
+		for (int i = 0; i < events.size(); i++) {
+			switch (events.getType(i)) {
+			case MIDI_EVENT_NOTE_ON:
+				noteOn(events.getChan(i), events.getKey(i), i);
+				break;
+			case MIDI_EVENT_NOTE_OFF:
+			case MIDI_EVENT_NOTE_STOP:
+				noteEnd(events, events.getChan(i), events.getKey(i), i);
+				break;
+			case MIDI_EVENT_NOTESOFF:
+			case MIDI_EVENT_SOUNDOFF:
+				allNotesEnd(events, events.getChan(i), i);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+};
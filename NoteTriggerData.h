@@ -8,11 +8,11 @@ class NoteTriggerData {
 public:
 	NesChannel nesChannel;
 	Preset::Duty duty;
-	Preset preset;
+	Preset const* preset; // owned by InstrumentBase
 	bool lowerKeysFirst;
 
 	NoteTriggerData(NesChannel nesChannel, Preset::Duty duty, Preset const& preset, bool lowerKeysFirst) :
-		nesChannel(nesChannel), duty(duty), preset(preset), lowerKeysFirst(lowerKeysFirst) {}
+		nesChannel(nesChannel), duty(duty), preset(&preset), lowerKeysFirst(lowerKeysFirst) {}
 
 	std::optional<NesDuty> getNesDuty() const {
 		switch (duty) {
@@ -0,0 +1,114 @@
+#pragma once
+#include "commons.h"
+#include "json.hpp"
+
+// policy of ChannelAssigner that collects nothing, every call compiles away
+class NoSearchStats {
+public:
+	void startSection(int, int) {}
+	void setCacheHit() {}
+	void addExpandedNode() {}
+	void addDuplicate() {}
+	void addScoring() {}
+	void addRound() {}
+	void addBestScore(double) {}
+	void endSection() {}
+	void addBranch(NoSearchStats const&) {}
+	void append(NoSearchStats const&) {}
+};
+
+// policy of ChannelAssigner that counts the work of the search in every section
+class SearchStats {
+private:
+	class Section {
+	public:
+		int eventIndex = 0;
+		int pass = 0; // parallel search - 0 speculative, later passes search again sections whose start changed
+		bool cacheHit = false;
+		int64_t expandedNodes = 0; // states whose moves were tried
+		int64_t duplicates = 0; // moves to already visited states
+		int64_t scorings = 0;
+		int rounds = 0; // iterative deepening rounds or beam levels
+		std::vector<std::pair<double, double>> bestScores; // seconds since the section start and the new best score
+		double seconds = 0;
+
+		Section(int eventIndex, int pass) : eventIndex(eventIndex), pass(pass) {}
+	};
+
+	std::vector<Section> sections;
+	std::chrono::steady_clock::time_point sectionStart;
+
+	double getSectionSeconds() const {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - sectionStart).count();
+	}
+
+public:
+	void startSection(int eventIndex, int pass) {
+		sections.emplace_back(eventIndex, pass);
+		sectionStart = std::chrono::steady_clock::now();
+	}
+
+	void setCacheHit() {
+		sections.back().cacheHit = true;
+	}
+
+	void addExpandedNode() {
+		sections.back().expandedNodes++;
+	}
+
+	void addDuplicate() {
+		sections.back().duplicates++;
+	}
+
+	void addScoring() {
+		sections.back().scorings++;
+	}
+
+	void addRound() {
+		sections.back().rounds++;
+	}
+
+	void addBestScore(double score) {
+		sections.back().bestScores.emplace_back(getSectionSeconds(), score);
+	}
+
+	void endSection() {
+		sections.back().seconds = getSectionSeconds();
+	}
+
+	// the work of a branch assigner of the split depth first search, in its current section
+	void addBranch(SearchStats const& branch) {
+		Section const& branchSection = branch.sections.back();
+		sections.back().expandedNodes += branchSection.expandedNodes;
+		sections.back().duplicates += branchSection.duplicates;
+		sections.back().scorings += branchSection.scorings;
+	}
+
+	// sections searched by other assigners of the song, kept in the order of the song and then of the passes
+	void append(SearchStats const& other) {
+		sections.insert(sections.end(), other.sections.begin(), other.sections.end());
+		std::ranges::stable_sort(sections, [](Section const& a, Section const& b) { return std::pair(a.eventIndex, a.pass) < std::pair(b.eventIndex, b.pass); });
+	}
+
+	nlohmann::json toJson() const {
+		nlohmann::json result = nlohmann::json::array();
+		for (Section const& section : sections) {
+			nlohmann::json bestScores = nlohmann::json::array();
+			for (auto const& [seconds, score] : section.bestScores) {
+				bestScores.push_back({ { "seconds", seconds }, { "score", score } });
+			}
+			result.push_back({
+				{ "event_index", section.eventIndex },
+				{ "pass", section.pass },
+				{ "cache_hit", section.cacheHit },
+				{ "expanded_nodes", section.expandedNodes },
+				{ "duplicates", section.duplicates },
+				{ "scorings", section.scorings },
+				{ "rounds", section.rounds },
+				{ "best_scores", bestScores },
+				{ "seconds", section.seconds },
+			});
+		}
+		return result;
+	}
+};
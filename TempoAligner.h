@@ -0,0 +1,130 @@
+#pragma once
+#include "commons.h"
+#include "EventStore.h"
+#include "TempoMap.h"
+#include "TempoFitter.h"
+#include "FileSettingsJson.h"
+
+// fits a separate speed to every tempo section of a song, so a tempo change does not move the following notes off the row grid
+// sections are fitted on their own workers, every section starts at a row
+class TempoAligner {
+private:
+	static constexpr int MIN_SECTION_NOTES = TempoFitter::MIN_SECTION_NOTES; // shorter sections are merged
+	static constexpr double ROW_EPSILON = 1e-6;
+
+	class Section {
+	public:
+		double start;
+		double end;
+		std::vector<double> noteOnSeconds; // relative to start
+
+		Section(double start, double end) : start(start), end(end) {}
+	};
+
+	std::vector<Section> sections;
+
+	// sections start at the tempo map segments inside the song that change the tempo, relative to the song start
+	static std::vector<double> getSectionStarts(TempoMap const& tempoMap, double songStart, double songLength) {
+		std::vector<double> starts = { 0 };
+		std::vector<TempoMap::Segment> const& segments = tempoMap.getSegments();
+		for (size_t i = 1; i < segments.size(); i++) {
+			double start = segments[i].seconds - songStart;
+			if (start >= songLength) {
+				break;
+			}
+			if (segments[i].microsPerQuarter != segments[i - 1].microsPerQuarter && start > starts.back()) {
+				starts.push_back(start);
+			}
+		}
+		return starts;
+	}
+
+	static void mergeSection(Section& target, Section const& source) {
+		for (double seconds : source.noteOnSeconds) {
+			target.noteOnSeconds.push_back(source.start + seconds - target.start);
+		}
+		target.end = source.end;
+	}
+
+public:
+	// without splitSections the whole song is one section and gets a single speed
+	TempoAligner(EventStore const& events, TempoMap const& tempoMap, double songStart, double songLength, bool splitSections) {
+		std::vector<double> starts = splitSections ? getSectionStarts(tempoMap, songStart, songLength) : std::vector<double>{ 0 };
+
+		std::vector<Section> allSections;
+		for (size_t i = 0; i < starts.size(); i++) {
+			allSections.emplace_back(starts[i], i + 1 < starts.size() ? starts[i + 1] : max(songLength, starts[i]));
+		}
+
+		size_t section = 0;
+		for (int i = 0; i < events.size(); i++) {
+			if (events.getType(i) != MIDI_EVENT_NOTE_ON) {
+				continue;
+			}
+			double seconds = events.getSeconds(i);
+			while (section + 1 < allSections.size() && allSections[section + 1].start <= seconds) {
+				section++;
+			}
+			allSections[section].noteOnSeconds.push_back(seconds - allSections[section].start);
+		}
+
+		for (auto const& current : allSections) {
+			if (!sections.empty() && (sections.back().noteOnSeconds.size() < MIN_SECTION_NOTES || current.noteOnSeconds.size() < MIN_SECTION_NOTES)) {
+				mergeSection(sections.back(), current);
+			}
+			else {
+				sections.push_back(current);
+			}
+		}
+	}
+
+	// a song with one section uses all threads for its sweep, otherwise the threads fit different sections
+	std::vector<EventStore::SpeedSection> fit(double rowsPerSecond, AdjustSpeedMode mode, int threadCount) const {
+		threadCount = threadCount > 0 ? threadCount : max(1, int(std::thread::hardware_concurrency()));
+		int fitterThreadCount = sections.size() == 1 ? threadCount : 1;
+
+		std::vector<double> speeds(sections.size(), 1);
+		std::vector<std::exception_ptr> errors(sections.size());
+		std::atomic<size_t> nextSection = 0;
+		auto worker = [this, &speeds, &errors, &nextSection, rowsPerSecond, mode, fitterThreadCount]() {
+			for (size_t i = nextSection++; i < sections.size(); i = nextSection++) {
+				try {
+					Section const& section = sections[i];
+					TempoFitter fitter(std::vector<double>(section.noteOnSeconds), rowsPerSecond, fitterThreadCount);
+					double length = section.end - section.start;
+					speeds[i] = (mode == AdjustSpeedMode::HISTOGRAM ? fitter.findBestSpeedFromHistogram(length) : fitter.findBestSpeed(length));
+				}
+				catch (...) {
+					errors[i] = std::current_exception();
+				}
+			}
+		};
+
+		{
+			int workerCount = int(min(size_t(threadCount), sections.size()));
+			std::vector<std::jthread> workers;
+			for (int i = 1; i < workerCount; i++) {
+				workers.emplace_back(worker);
+			}
+			worker();
+		}
+
+		for (auto const& error : errors) {
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+
+		// the next section starts at the first row after the end of the previous one
+		std::vector<EventStore::SpeedSection> results;
+		for (size_t i = 0; i < sections.size(); i++) {
+			double newStart = 0;
+			if (i > 0) {
+				double newEnd = results.back().getNewSeconds(sections[i].start);
+				newStart = ceil(newEnd * rowsPerSecond - ROW_EPSILON) / rowsPerSecond;
+			}
+			results.emplace_back(sections[i].start, newStart, speeds[i]);
+		}
+		return results;
+	}
+};
@@ -0,0 +1,315 @@
+#pragma once
+#include "commons.h"
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEMPO_FITTER_SSE2
+#endif
+
+// finds the speed multiplier that moves note ons closest to the row grid
+// every SIMD lane scores a different speed and adds the notes in the same order as the scalar code, so the scores are bit identical
+class TempoFitter {
+private:
+	static constexpr double DISTANCE_WEIGHT = 30;
+	static constexpr double SPEED_WEIGHT = 4;
+	static constexpr double MIN_SPEED = 0.8;
+	static constexpr double MAX_SPEED = 1.2;
+
+	// histogram of intervals between note ons, bins grow by 1%
+	static constexpr double MIN_INTERVAL = 0.02;
+	static constexpr double MAX_INTERVAL = 2;
+	static constexpr double BIN_RATIO = 1.01;
+	static constexpr int MIN_BIN_SHARE = 4; // the grid interval needs at least 1/4 of the most frequent interval count
+	static constexpr double MAX_GRID_ERROR = 0.15; // in grid units, intervals further from a multiple are ignored
+
+	// speeds are also derived from whole beats and bars, when the shortest interval has no integer row count
+	static constexpr std::array<int, 6> GRID_MULTIPLES = { 1, 2, 3, 4, 6, 8 };
+	static constexpr double MAX_UNIT_ROWS = 64;
+
+	std::vector<double> noteOnSeconds;
+	double rowsPerSecond;
+	int threadCount;
+
+	// same as NesState::getRow followed by NesState::getSeconds with zero row shift
+	double getNoteScore(double noteSeconds, double speed) const {
+		double seconds = noteSeconds * speed;
+		double resultSeconds = round(seconds * rowsPerSecond) / rowsPerSecond;
+		return max(0, 1 - std::abs(seconds - resultSeconds) * DISTANCE_WEIGHT);
+	}
+
+	double getGridScore(double speed, size_t noteCount) const {
+		double score = 0;
+		for (size_t i = 0; i < noteCount; i++) {
+			score += getNoteScore(noteOnSeconds[i], speed);
+		}
+		return score;
+	}
+
+	// round() is half away from zero, for not negative values it is floor plus 1 when the fraction is at least 0.5
+#if defined(__AVX__)
+	static constexpr size_t LANES = 4;
+
+	void getGridScores(const double* speeds, size_t noteCount, double* scores) const {
+		const __m256d speed = _mm256_loadu_pd(speeds);
+		const __m256d rate = _mm256_set1_pd(rowsPerSecond);
+		const __m256d half = _mm256_set1_pd(0.5);
+		const __m256d one = _mm256_set1_pd(1);
+		const __m256d weight = _mm256_set1_pd(DISTANCE_WEIGHT);
+		const __m256d signBit = _mm256_set1_pd(-0.0);
+		const __m256d zero = _mm256_setzero_pd();
+
+		__m256d score = zero;
+		for (size_t i = 0; i < noteCount; i++) {
+			__m256d seconds = _mm256_mul_pd(_mm256_set1_pd(noteOnSeconds[i]), speed);
+			__m256d rows = _mm256_mul_pd(seconds, rate);
+			__m256d floorRows = _mm256_floor_pd(rows);
+			__m256d roundUp = _mm256_and_pd(_mm256_cmp_pd(_mm256_sub_pd(rows, floorRows), half, _CMP_GE_OQ), one);
+			__m256d resultSeconds = _mm256_div_pd(_mm256_add_pd(floorRows, roundUp), rate);
+			__m256d distance = _mm256_andnot_pd(signBit, _mm256_sub_pd(seconds, resultSeconds));
+			score = _mm256_add_pd(score, _mm256_max_pd(_mm256_sub_pd(one, _mm256_mul_pd(distance, weight)), zero));
+		}
+		_mm256_storeu_pd(scores, score);
+	}
+#elif defined(TEMPO_FITTER_SSE2)
+	static constexpr size_t LANES = 2;
+
+	// no floor instruction before SSE4.1, truncation to int32 is the floor of a not negative row
+	void getGridScores(const double* speeds, size_t noteCount, double* scores) const {
+		const __m128d speed = _mm_loadu_pd(speeds);
+		const __m128d rate = _mm_set1_pd(rowsPerSecond);
+		const __m128d half = _mm_set1_pd(0.5);
+		const __m128d one = _mm_set1_pd(1);
+		const __m128d weight = _mm_set1_pd(DISTANCE_WEIGHT);
+		const __m128d signBit = _mm_set1_pd(-0.0);
+		const __m128d zero = _mm_setzero_pd();
+
+		__m128d score = zero;
+		for (size_t i = 0; i < noteCount; i++) {
+			__m128d seconds = _mm_mul_pd(_mm_set1_pd(noteOnSeconds[i]), speed);
+			__m128d rows = _mm_mul_pd(seconds, rate);
+			__m128d floorRows = _mm_cvtepi32_pd(_mm_cvttpd_epi32(rows));
+			__m128d roundUp = _mm_and_pd(_mm_cmpge_pd(_mm_sub_pd(rows, floorRows), half), one);
+			__m128d resultSeconds = _mm_div_pd(_mm_add_pd(floorRows, roundUp), rate);
+			__m128d distance = _mm_andnot_pd(signBit, _mm_sub_pd(seconds, resultSeconds));
+			score = _mm_add_pd(score, _mm_max_pd(_mm_sub_pd(one, _mm_mul_pd(distance, weight)), zero));
+		}
+		_mm_storeu_pd(scores, score);
+	}
+#else
+	static constexpr size_t LANES = 1;
+
+	void getGridScores(const double* speeds, size_t noteCount, double* scores) const {
+		scores[0] = getGridScore(speeds[0], noteCount);
+	}
+#endif
+
+	size_t getNoteCount(double secondsLimit) const {
+		return std::upper_bound(noteOnSeconds.begin(), noteOnSeconds.end(), secondsLimit) - noteOnSeconds.begin();
+	}
+
+	// workers take groups of LANES speeds and write only their own scores, so the result does not depend on the thread count
+	void scoreGroups(std::vector<double> const& speeds, size_t noteCount, std::vector<double>& scores, std::atomic<size_t>& nextGroup) const {
+		size_t groupCount = (speeds.size() + LANES - 1) / LANES;
+		for (size_t group = nextGroup++; group < groupCount; group = nextGroup++) {
+			size_t i = group * LANES;
+			if (i + LANES <= speeds.size()) {
+				getGridScores(&speeds[i], noteCount, &scores[i]);
+				continue;
+			}
+			for (; i < speeds.size(); i++) {
+				scores[i] = getGridScore(speeds[i], noteCount);
+			}
+		}
+	}
+
+	static void applySpeedWeights(std::vector<double> const& speeds, std::vector<double>& scores) {
+		for (size_t j = 0; j < speeds.size(); j++) {
+			scores[j] *= max(0, 1 - std::abs(1 - speeds[j]) * SPEED_WEIGHT);
+		}
+	}
+
+	// scores of the speeds, only note ons up to secondsLimit are counted
+	std::vector<double> getScores(std::vector<double> const& speeds, double secondsLimit) const {
+		size_t noteCount = getNoteCount(secondsLimit);
+		std::vector<double> scores(speeds.size());
+		std::atomic<size_t> nextGroup = 0;
+		auto worker = [this, &speeds, &scores, &nextGroup, noteCount]() {
+			scoreGroups(speeds, noteCount, scores, nextGroup);
+		};
+
+		{
+			int workerCount = int(min(size_t(threadCount), (speeds.size() + LANES - 1) / LANES));
+			std::vector<std::jthread> workers;
+			for (int i = 1; i < workerCount; i++) {
+				workers.emplace_back(worker);
+			}
+			worker();
+		}
+
+		applySpeedWeights(speeds, scores);
+		return scores;
+	}
+
+	// shortest interval between note ons that is frequent enough to be the rhythmic grid of the song
+	std::optional<double> findGridInterval() const {
+		std::vector<double> intervals;
+		for (size_t i = 1; i < noteOnSeconds.size(); i++) {
+			double interval = noteOnSeconds[i] - noteOnSeconds[i - 1];
+			if (interval >= MIN_INTERVAL && interval < MAX_INTERVAL) {
+				intervals.push_back(interval);
+			}
+		}
+		if (intervals.empty()) {
+			return {};
+		}
+
+		auto getBin = [](double interval) { return int(std::log(interval / MIN_INTERVAL) / std::log(BIN_RATIO)); };
+		std::vector<int> histogram(size_t(getBin(MAX_INTERVAL)) + 1, 0);
+		for (double interval : intervals) {
+			histogram[getBin(interval)]++;
+		}
+
+		int maxCount = *std::max_element(histogram.begin(), histogram.end());
+		int gridBin = int(std::find_if(histogram.begin(), histogram.end(), [maxCount](int count) { return count * MIN_BIN_SHARE >= maxCount; }) - histogram.begin());
+
+		// rough estimate from the neighbourhood of the bin, the peak can be split between bins
+		double sum = 0;
+		int count = 0;
+		for (double interval : intervals) {
+			if (std::abs(getBin(interval) - gridBin) <= 1) {
+				sum += interval;
+				count++;
+			}
+		}
+		double roughInterval = sum / count;
+
+		// least squares fit of interval = multiple * gridInterval
+		double sumMultipleInterval = 0;
+		double sumMultipleSquared = 0;
+		for (double interval : intervals) {
+			double units = interval / roughInterval;
+			double multiple = round(units);
+			if (multiple >= 1 && std::abs(units - multiple) <= MAX_GRID_ERROR) {
+				sumMultipleInterval += multiple * interval;
+				sumMultipleSquared += multiple * multiple;
+			}
+		}
+		return sumMultipleInterval / sumMultipleSquared;
+	}
+
+	// speeds which make a whole number of rows from the grid interval or its multiples
+	std::vector<double> getGridSpeeds(double gridInterval) const {
+		std::vector<double> speeds = { 1 };
+		for (int multiple : GRID_MULTIPLES) {
+			double unitRows = rowsPerSecond * gridInterval * multiple;
+			if (unitRows > MAX_UNIT_ROWS) {
+				break;
+			}
+			for (int rows = int(ceil(unitRows * MIN_SPEED)); rows <= int(floor(unitRows * MAX_SPEED)); rows++) {
+				speeds.push_back(rows / unitRows);
+			}
+		}
+
+		std::sort(speeds.begin(), speeds.end());
+		speeds.erase(std::unique(speeds.begin(), speeds.end()), speeds.end());
+		return speeds;
+	}
+
+public:
+	static constexpr int MIN_SECTION_NOTES = 16; // too few notes do not define a tempo
+
+	// noteOnSeconds must be sorted, threadCount 0 uses all hardware threads
+	TempoFitter(std::vector<double>&& noteOnSeconds, double rowsPerSecond, int threadCount = 1) : noteOnSeconds(std::move(noteOnSeconds)), rowsPerSecond(rowsPerSecond),
+		threadCount(threadCount > 0 ? threadCount : max(1, int(std::thread::hardware_concurrency()))) {}
+
+	// grid search refined around the best speed, every round doubles the scored song time
+	// the workers are started once, the last one arriving at the barrier finishes the round and prepares the next one
+	double findBestSpeed(double songLength) const {
+		double bestSpeed = 1;
+
+		double secondsLimit = 10;
+
+		double speedMin = MIN_SPEED;
+		double speedMax = MAX_SPEED;
+		double speedStep = 1 / 10000.0;
+
+		std::vector<double> speeds;
+		std::vector<double> scores;
+		size_t noteCount = 0;
+		std::atomic<size_t> nextGroup = 0;
+		bool done = false;
+
+		// the first round has the most candidates, later rounds only the 33 around the best speed
+		// the vectors are reserved for it here, so preparing a round in the noexcept completion of the barrier does not allocate
+		size_t maxCandidates = size_t((speedMax - speedMin) / speedStep) + 2;
+		speeds.reserve(maxCandidates);
+		scores.reserve(maxCandidates);
+
+		// candidates are accumulated from speedMin, in the same order as they are compared
+		auto prepareRound = [&]() {
+			speeds.clear();
+			for (double speed = speedMin; speed <= speedMax && speeds.size() < maxCandidates; speed += speedStep) {
+				speeds.push_back(speed);
+			}
+			scores.assign(speeds.size(), 0);
+			noteCount = getNoteCount(secondsLimit);
+			nextGroup = 0;
+		};
+
+		// serial reduction, the first of equal scores wins
+		auto finishRound = [&]() noexcept {
+			applySpeedWeights(speeds, scores);
+			double bestScore = -1;
+			for (size_t i = 0; i < speeds.size(); i++) {
+				if (scores[i] > bestScore) {
+					bestScore = scores[i];
+					bestSpeed = speeds[i];
+				}
+			}
+
+			if (secondsLimit >= songLength) {
+				done = true;
+				return;
+			}
+			secondsLimit *= 2;
+			speedStep *= 0.5;
+			speedMin = bestSpeed - 16 * speedStep;
+			speedMax = bestSpeed + 16 * speedStep;
+			prepareRound();
+		};
+
+		prepareRound();
+		int workerCount = max(1, int(min(size_t(threadCount), (speeds.size() + LANES - 1) / LANES)));
+		std::barrier roundEnd(workerCount, finishRound);
+		auto worker = [this, &speeds, &scores, &noteCount, &nextGroup, &done, &roundEnd]() {
+			while (!done) {
+				scoreGroups(speeds, noteCount, scores, nextGroup);
+				roundEnd.arrive_and_wait();
+			}
+		};
+
+		{
+			std::vector<std::jthread> workers;
+			for (int i = 1; i < workerCount; i++) {
+				workers.emplace_back(worker);
+			}
+			worker();
+		}
+
+		return bestSpeed;
+	}
+
+	// estimates the rhythmic grid from a histogram of note on intervals in O(N), then scores only the speeds that fit it to the rows
+	// falls back to the grid search when there are too few notes or no interval fits the histogram
+	double findBestSpeedFromHistogram(double songLength) const {
+		std::optional<double> gridInterval = noteOnSeconds.size() >= MIN_SECTION_NOTES ? findGridInterval() : std::nullopt;
+		if (!gridInterval) {
+			return findBestSpeed(songLength);
+		}
+
+		std::vector<double> speeds = getGridSpeeds(gridInterval.value());
+		std::vector<double> scores = getScores(speeds, songLength);
+		return speeds[std::max_element(scores.begin(), scores.end()) - scores.begin()];
+	}
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include "commons.h"
+
+// tick to seconds conversion built once from the tempo events of a MIDI file
+class TempoMap {
+public:
+	// constant tempo between this segment tick and the next segment tick
+	class Segment {
+	public:
+		uint64_t tick;
+		double seconds;
+		double secondsPerTick;
+		uint32_t microsPerQuarter;
+
+		Segment() = default;
+		Segment(uint64_t tick, double seconds, double secondsPerTick, uint32_t microsPerQuarter) :
+			tick(tick), seconds(seconds), secondsPerTick(secondsPerTick), microsPerQuarter(microsPerQuarter) {}
+
+		double getSeconds(uint64_t tick_) const {
+			return seconds + double(tick_ - tick) * secondsPerTick;
+		}
+	};
+
+private:
+	friend class EventCache;
+
+	int division;
+	std::vector<Segment> segments;
+
+	double getSecondsPerTick(uint32_t microsPerQuarter) const {
+		if (isSmpte()) {
+			return 1.0 / (double(-(division >> 8)) * (division & 0xFF));
+		}
+		return microsPerQuarter / 1000000.0 / division;
+	}
+
+public:
+	// monotonic walk for sorted ticks, O(1) amortized per conversion
+	class Cursor {
+	private:
+		const TempoMap& tempoMap;
+		size_t segment = 0;
+
+	public:
+		explicit Cursor(TempoMap const& tempoMap) : tempoMap(tempoMap) {}
+
+		double getSeconds(uint64_t tick) {
+			auto const& segments = tempoMap.segments;
+			while (segment + 1 < segments.size() && segments[segment + 1].tick <= tick) {
+				segment++;
+			}
+			return segments[segment].getSeconds(tick);
+		}
+	};
+
+	static constexpr uint32_t DEFAULT_MICROS_PER_QUARTER = 500000;
+
+	TempoMap() : TempoMap(1) {}
+
+	// positive division is ticks per quarter note, negative is SMPTE (-frames per second in high byte, ticks per frame in low byte)
+	explicit TempoMap(int division) : division(division) {
+		segments.emplace_back(0, 0, getSecondsPerTick(DEFAULT_MICROS_PER_QUARTER), DEFAULT_MICROS_PER_QUARTER);
+	}
+
+	// tempo changes have to be added in tick order, SMPTE timing ignores them
+	void addTempo(uint64_t tick, uint32_t microsPerQuarter) {
+		if (isSmpte() || microsPerQuarter == 0) {
+			return;
+		}
+
+		Segment const& last = segments.back();
+		double seconds = last.getSeconds(tick);
+		if (last.tick == tick) {
+			segments.pop_back();
+		}
+		segments.emplace_back(tick, seconds, getSecondsPerTick(microsPerQuarter), microsPerQuarter);
+	}
+
+	double getSeconds(uint64_t tick) const {
+		auto it = std::ranges::upper_bound(segments, tick, {}, &Segment::tick);
+		return std::prev(it)->getSeconds(tick);
+	}
+
+	std::vector<Segment> const& getSegments() const {
+		return segments;
+	}
+
+	bool isSmpte() const {
+		return division < 0;
+	}
+};
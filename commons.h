@@ -16,9 +16,31 @@
 #include <bitset>
 #include <functional>
 #include <thread>
+#include <atomic>
+#include <queue>
+#include <climits>
+#include <limits>
+#include <bit>
+#include <cstring>
+#include <cwctype>
+#include <format>
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+#include <chrono>
+#include <mutex>
+#include <span>
+#include <barrier>
+#include <random>
 
-#include "bass.h"
-#include "bassmidi.h"
+// mixed-type replacements for the windows.h min/max macros
+template<typename A, typename B> constexpr std::common_type_t<A, B> min(A a, B b) {
+	return b < a ? b : a;
+}
+
+template<typename A, typename B> constexpr std::common_type_t<A, B> max(A a, B b) {
+	return a < b ? b : a;
+}
 
 std::wstring hex1(int number) {
 	std::wstringstream stream;
@@ -3,50 +3,131 @@
 
 #include "commons.h"
 #include "FamiTrackerFile.h"
-#include "Converter.h"
+#include "AlbumConverter.h"
 
-void processFile(int i, int argc, char* arg) {
-	std::filesystem::path midiFile = arg;
+class CommandLine {
+public:
+	std::vector<std::filesystem::path> midiFiles;
+	std::optional<std::filesystem::path> cacheDirectory;
+	std::optional<std::filesystem::path> albumDirectory;
+	bool stats = false;
+
+	CommandLine(int argc, char** argv) {
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			if (arg == "--cache" && i + 1 < argc) {
+				cacheDirectory = argv[++i];
+			}
+			else if (arg == "--album" && i + 1 < argc) {
+				albumDirectory = argv[++i];
+			}
+			else if (arg == "--stats") {
+				stats = true;
+			}
+			else {
+				midiFiles.emplace_back(arg);
+			}
+		}
+	}
+};
+
+// next to the txt file, <name>.json is taken by the settings of the MIDI file
+void exportStats(AlbumConverter const& converter, std::filesystem::path const& txtFile) {
+	std::filesystem::path statsFile = txtFile;
+	statsFile.replace_extension("stats.json");
+	converter.exportStats(statsFile);
+	std::cout << "Search stats exported to " << statsFile << std::endl;
+}
+
+void processFile(int i, CommandLine const& commandLine, AssignCache& assignCache) {
+	std::filesystem::path midiFile = commandLine.midiFiles[i];
 	std::filesystem::path txtFile = midiFile;
 	txtFile.replace_extension("txt");
-	std::filesystem::path jsonFile = midiFile;
-	jsonFile.replace_extension("json");
 
-	std::wcout << i << "/" << (argc - 1) << " Converting " << midiFile << std::endl;
+	std::cout << (i + 1) << "/" << commandLine.midiFiles.size() << " Converting " << midiFile << std::endl;
 
-	HSTREAM handle = BASS_MIDI_StreamCreateFile(false, midiFile.c_str(), 0, 0, BASS_UNICODE, 44100);
-	if (handle == 0) {
-		std::cout << "BASS_MIDI_StreamCreateFile error, code " << BASS_ErrorGetCode() << std::endl;
+	FamiTrackerFile file;
+	try {
+		AlbumConverter converter(assignCache, commandLine.cacheDirectory, commandLine.stats);
+		converter.addMidiFile(midiFile);
+		file = converter.convert(midiFile.stem().wstring());
+		if (commandLine.stats) {
+			exportStats(converter, txtFile);
+		}
+	}
+	catch (std::exception const& e) {
+		std::cout << "MIDI file error: " << e.what() << std::endl;
 		return;
 	}
 
-	FamiTrackerFile file = std::make_unique<Converter>(FileSettingsJson(jsonFile))->convert(handle);
-	BASS_StreamFree(handle);
+	file.exportTxt(txtFile);
+	std::cout << "Successfully exported to " << txtFile << std::endl << std::endl;
+}
+
+// all MIDI files of the directory become tracks of one file with shared instruments
+void processAlbum(CommandLine const& commandLine, AssignCache& assignCache) {
+	std::filesystem::path directory = commandLine.albumDirectory.value();
+	std::filesystem::path txtFile = directory / directory.filename();
+	txtFile.replace_extension("txt");
+
+	std::vector<std::filesystem::path> midiFiles;
+	std::error_code error;
+	for (auto const& entry : std::filesystem::directory_iterator(directory, error)) {
+		std::wstring extension = entry.path().extension().wstring();
+		std::ranges::transform(extension, extension.begin(), [](wchar_t c) { return wchar_t(std::towlower(c)); });
+		if (entry.is_regular_file() && (extension == L".mid" || extension == L".midi")) {
+			midiFiles.push_back(entry.path());
+		}
+	}
+	std::ranges::sort(midiFiles);
+
+	AlbumConverter converter(assignCache, commandLine.cacheDirectory, commandLine.stats);
+	for (auto const& midiFile : midiFiles) {
+		std::cout << "Adding " << midiFile << " to album " << directory << std::endl;
+		try {
+			converter.addMidiFile(midiFile);
+		}
+		catch (std::exception const& e) {
+			std::cout << "MIDI file error: " << e.what() << std::endl;
+		}
+	}
+	if (converter.getSongCount() == 0) {
+		std::cout << "No MIDI files in " << directory << std::endl;
+		return;
+	}
 
-	std::wstring title = midiFile.stem().wstring();
-	if (title.length() > 31) {
-		title = title.substr(0, 31); // apparently there is a char limit in the title
+	FamiTrackerFile file;
+	try {
+		file = converter.convert(directory.filename().wstring());
+		if (commandLine.stats) {
+			exportStats(converter, txtFile);
+		}
+	}
+	catch (std::exception const& e) {
+		std::cout << "MIDI file error: " << e.what() << std::endl;
+		return;
 	}
-	file.title = file.tracks[0]->name = title;
+
 	file.exportTxt(txtFile);
-	std::cout << "Successfully exported to " << txtFile << std::endl << std::endl;
+	std::cout << "Successfully exported album to " << txtFile << std::endl << std::endl;
 }
 
 int main(int argc, char** argv) {
-    if (argc < 2) {
-        std::cout << "Usage: MidiToFamiTrackerConverter <midi_file_1> <midi_file_2> ..." << std::endl;
+	CommandLine commandLine(argc, argv);
+    if (commandLine.midiFiles.empty() && !commandLine.albumDirectory) {
+        std::cout << "Usage: MidiToFamiTrackerConverter [--cache <directory>] [--album <directory>] [--stats] <midi_file_1> <midi_file_2> ..." << std::endl;
         return 1;
     }
 
-    if (!BASS_Init(-1, 44100, 0, nullptr, nullptr)) {
-        std::cout << "BASS_Init error, code " << BASS_ErrorGetCode() << std::endl;
-        return 2;
-    }
-
+	AssignCache assignCache(commandLine.cacheDirectory);
 	std::vector<std::jthread> threads;
 
-    for (int i = 1; i < argc; i++) {
-		threads.emplace_back(&processFile, i, argc, argv[i]);
+	if (commandLine.albumDirectory) {
+		threads.emplace_back(&processAlbum, std::cref(commandLine), std::ref(assignCache));
+	}
+
+    for (size_t i = 0; i < commandLine.midiFiles.size(); i++) {
+		threads.emplace_back(&processFile, i, std::cref(commandLine), std::ref(assignCache));
     }
 
 	for (auto& t : threads) {
@@ -55,6 +136,9 @@ int main(int argc, char** argv) {
 		}
 	}
 
+	std::cout << "Channel assignment cache: " << assignCache.getHits() << " hits, " << assignCache.getMisses() << " misses" << std::endl;
+	assignCache.store();
+
     return 0;
 }
 
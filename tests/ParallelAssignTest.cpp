@@ -0,0 +1,96 @@
+// checks that the parallel channel assignment (assign_threads > 1) gives the same file as the sequential one
+// and that the split depth first search (search_threads > 1) gives the same file for every thread count
+// build and run from the repository root:
+//   g++ -std=c++20 -O2 -I. -o ParallelAssignTest tests/ParallelAssignTest.cpp && ./ParallelAssignTest
+// returns 0 when the files of every check are the same
+
+#include "../commons.h"
+#include "../FamiTrackerFile.h"
+#include "../AlbumConverter.h"
+
+static constexpr int SECTION_COUNT = 12;
+static constexpr int CHANNEL_COUNT = 4;
+static constexpr int NOTES_PER_SECTION = 48;
+static constexpr int TICKS_PER_NOTE = 120;
+
+static void writeVariableLength(std::string& data, uint32_t value) {
+	std::string bytes(1, char(value & 0x7F));
+	while (value >>= 7) {
+		bytes.insert(bytes.begin(), char((value & 0x7F) | 0x80));
+	}
+	data += bytes;
+}
+
+// format 0 song, one channel changes its program at every section start while the others keep theirs
+// so every section starts from the channels of the previous one and depends on its result
+static void writeSong(std::filesystem::path const& path) {
+	std::mt19937 random(1);
+	std::array<int, CHANNEL_COUNT> programs = { 0, 33, 40, 73 };
+	std::string track;
+
+	for (int section = 0; section < SECTION_COUNT; section++) {
+		int changed = section % CHANNEL_COUNT;
+		programs[changed] = (programs[changed] + 8 + section) % 96;
+		for (int chan = 0; chan < CHANNEL_COUNT; chan++) {
+			writeVariableLength(track, 0);
+			track += { char(0xC0 | chan), char(programs[chan]) };
+		}
+
+		for (int note = 0; note < NOTES_PER_SECTION; note++) {
+			int chan = int(random() % CHANNEL_COUNT);
+			int key = 48 + int(random() % 24);
+			writeVariableLength(track, 0);
+			track += { char(0x90 | chan), char(key), char(100) };
+			writeVariableLength(track, TICKS_PER_NOTE);
+			track += { char(0x80 | chan), char(key), char(0) };
+		}
+	}
+	writeVariableLength(track, 0);
+	track += { char(0xFF), char(0x2F), char(0) };
+
+	auto bigEndian = [](uint32_t value, int size) {
+		std::string bytes;
+		for (int i = size - 1; i >= 0; i--) {
+			bytes += char((value >> (8 * i)) & 0xFF);
+		}
+		return bytes;
+	};
+
+	std::ofstream file(path, std::ios::binary);
+	file << "MThd" << bigEndian(6, 4) << bigEndian(0, 2) << bigEndian(1, 2) << bigEndian(480, 2);
+	file << "MTrk" << bigEndian(uint32_t(track.size()), 4) << track;
+}
+
+// every run has its own directory and assignment cache, so it does not reuse the sections of the other run
+static std::string convert(std::filesystem::path const& directory, std::string const& settings) {
+	std::filesystem::create_directories(directory);
+	std::filesystem::path midiFile = directory / "song.mid";
+	writeSong(midiFile);
+	std::ofstream(directory / "song.json") << settings;
+
+	AssignCache assignCache;
+	AlbumConverter converter(assignCache);
+	converter.addMidiFile(midiFile);
+	std::filesystem::path txtFile = directory / "song.txt";
+	converter.convert(L"song").exportTxt(txtFile);
+
+	std::ifstream file(txtFile);
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static bool check(std::string const& name, std::string const& settings1, std::string const& settings2) {
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "ParallelAssignTest";
+	std::string file1 = convert(directory / "1", settings1);
+	std::string file2 = convert(directory / "2", settings2);
+	std::filesystem::remove_all(directory);
+
+	bool same = !file1.empty() && file1 == file2;
+	std::cout << (same ? "OK: " : "FAILED: ") << name << std::endl;
+	return same;
+}
+
+int main() {
+	bool assignOk = check("parallel assignment is the same as the sequential one", R"({ "assign_threads": 1 })", R"({ "assign_threads": 4 })");
+	bool searchOk = check("split search does not depend on the thread count", R"({ "search_threads": 2 })", R"({ "search_threads": 4 })");
+	return assignOk && searchOk ? 0 : 1;
+}